@@ -0,0 +1,182 @@
+// coroutineFrame - per message cost of handling a message in a coroutine instead
+// of a callback.
+//
+// In memory, with no system call:
+//   call        direct function call
+//   callback    function<void()> invoked per message, like a task lambda
+//   resume      one long lived coroutine, suspended and resumed per message
+//   frame       a new CoTask per message, allocating and freeing its frame
+// Through the kernel, one byte per message over a socketpair:
+//   epoll       one-shot epoll registration, re-armed and dispatched to a callback
+//   reactor     a coroutine doing co_await readable(fd) on a CoReactor, resumed inline
+//
+// Usage: coroutineFrame [messages]
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+
+#include "../chatserver/coReactor.h"
+#include "../utils/coTask.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+constexpr size_t DEFAULT_MESSAGES = 10000000;
+constexpr size_t SOCKET_DIVISOR = 20; // the socket runs do this many times fewer messages
+
+volatile uint64_t g_Sink = 0;
+
+__attribute__((noinline)) void handleMessage(uint64_t message) {
+    g_Sink = g_Sink + message;
+}
+
+// nanosPerMessage - runs body and returns its time divided by messages
+template<typename Body>
+double nanosPerMessage(size_t messages, Body body) {
+    Clock::time_point start = Clock::now();
+    body();
+    return chrono::duration<double, nano>(Clock::now() - start).count() / messages;
+}
+
+// Mailbox - hands messages to a coroutine suspended in next()
+struct Mailbox {
+    coroutine_handle<> waiting;
+    uint64_t message{0};
+    bool closed{false};
+
+    struct Awaiter {
+        Mailbox& box;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(coroutine_handle<> handle) noexcept { box.waiting = handle; }
+        uint64_t await_resume() const noexcept { return box.message; }
+    };
+
+    Awaiter next() { return Awaiter{*this}; }
+
+    void deliver(uint64_t value) {
+        message = value;
+        exchange(waiting, {}).resume();
+    }
+};
+
+CoTask receiveLoop(Mailbox& box) {
+    while (true) {
+        uint64_t message = co_await box.next();
+        if (box.closed) {
+            co_return;
+        }
+        handleMessage(message);
+    }
+}
+
+CoTask handleOne(uint64_t message) {
+    handleMessage(message);
+    co_return;
+}
+
+CoTask readLoop(CoReactor& reactor, int fd, size_t messages) {
+    char byte;
+    for (size_t i = 0; i < messages; ++i) {
+        co_await reactor.readable(fd);
+        if (read(fd, &byte, 1) == 1) {
+            handleMessage(byte);
+        }
+    }
+}
+
+double runEpoll(size_t messages) {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    int epollFd = epoll_create1(0);
+    struct epoll_event event{};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.fd = fds[0];
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fds[0], &event);
+    function<void(int)> onReadable = [&](int fd) {
+        char byte;
+        if (read(fd, &byte, 1) == 1) {
+            handleMessage(byte);
+        }
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+    };
+    double result = nanosPerMessage(messages, [&] {
+        struct epoll_event ready;
+        for (size_t i = 0; i < messages; ++i) {
+            write(fds[1], "x", 1);
+            if (epoll_wait(epollFd, &ready, 1, -1) == 1) {
+                onReadable(ready.data.fd);
+            }
+        }
+    });
+    close(epollFd);
+    close(fds[0]);
+    close(fds[1]);
+    return result;
+}
+
+double runReactor(size_t messages) {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    CoReactor reactor([](coroutine_handle<> handle) { handle.resume(); });
+    if (reactor.init() != 0) {
+        return 0;
+    }
+    double result = nanosPerMessage(messages, [&] {
+        readLoop(reactor, fds[0], messages).start();
+        for (size_t i = 0; i < messages; ++i) {
+            write(fds[1], "x", 1);
+            reactor.poll();
+        }
+    });
+    close(fds[0]);
+    close(fds[1]);
+    return result;
+}
+
+int main(int argc, const char* argv[]) {
+    size_t messages = argc > 1 ? stoull(argv[1]) : DEFAULT_MESSAGES;
+    size_t socketMessages = max<size_t>(1, messages / SOCKET_DIVISOR);
+
+    cout << "messages: " << messages << " (socket runs: " << socketMessages << ")\n";
+    cout << "call      " << nanosPerMessage(messages, [&] {
+        for (size_t i = 0; i < messages; ++i) {
+            handleMessage(i);
+        }
+    }) << " ns/message\n";
+
+    function<void()> callback;
+    uint64_t current = 0;
+    callback = [&current] { handleMessage(current); };
+    cout << "callback  " << nanosPerMessage(messages, [&] {
+        for (size_t i = 0; i < messages; ++i) {
+            current = i;
+            callback();
+        }
+    }) << " ns/message\n";
+
+    Mailbox box;
+    receiveLoop(box).start();
+    cout << "resume    " << nanosPerMessage(messages, [&] {
+        for (size_t i = 0; i < messages; ++i) {
+            box.deliver(i);
+        }
+    }) << " ns/message\n";
+    box.closed = true;
+    box.deliver(0);
+
+    cout << "frame     " << nanosPerMessage(messages, [&] {
+        for (size_t i = 0; i < messages; ++i) {
+            handleOne(i).start();
+        }
+    }) << " ns/message\n";
+
+    cout << "epoll     " << runEpoll(socketMessages) << " ns/message\n";
+    cout << "reactor   " << runReactor(socketMessages) << " ns/message\n";
+    return 0;
+}
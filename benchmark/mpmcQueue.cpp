@@ -0,0 +1,153 @@
+// mpmcQueue - contended hand-off throughput of the lock-free MpmcQueue against
+// threadSafeQueue, with as many consumers as producers.
+//
+// Every producer pushes its share of the items, the consumers pop until all of
+// them are taken. Three variants:
+//   locked  threadSafeQueue push and tryPop
+//   mpmc    MpmcQueue tryPush and tryPop, one item per call
+//   bulk    MpmcQueue tryPushBulk and tryPopBulk, up to BULK_SIZE items per call
+// A thread that finds the queue full or empty yields, so the numbers also hold
+// when there are more threads than cores.
+//
+// Usage: mpmcQueue [items] [queue capacity]
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../utils/mpmcQueue.h"
+#include "../utils/threadSafeQueue.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+constexpr size_t DEFAULT_ITEMS = 2000000;
+constexpr size_t DEFAULT_CAPACITY = 16384;
+constexpr size_t THREAD_COUNTS[] = {1, 2, 4, 8};
+constexpr size_t BULK_SIZE = 32;
+
+// runThreads - starts producers and as many consumers, each producer pushing
+// items / producers values with push, each consumer taking values with pop
+// push: callable(uint64_t first, size_t count) pushing the values first .. first + count - 1
+// pop: callable(uint64_t& checksum) popping what it can, returning the number of values taken
+// Returns the throughput in millions of items per second
+template<typename Push, typename Pop>
+double runThreads(size_t producers, size_t items, Push push, Pop pop) {
+    size_t perProducer = items / producers;
+    size_t total = perProducer * producers;
+    atomic<size_t> consumed{0};
+    atomic<uint64_t> checksum{0};
+    Clock::time_point start = Clock::now();
+    {
+        vector<jthread> threads;
+        for (size_t p = 0; p < producers; ++p) {
+            threads.emplace_back([&push, perProducer] { push(1, perProducer); });
+            threads.emplace_back([&] {
+                uint64_t sum = 0;
+                while (consumed.load(memory_order_relaxed) < total) {
+                    size_t taken = pop(sum);
+                    if (taken == 0) {
+                        this_thread::yield();
+                    } else {
+                        consumed.fetch_add(taken, memory_order_relaxed);
+                    }
+                }
+                checksum.fetch_add(sum);
+            });
+        }
+    }
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+    uint64_t expected = static_cast<uint64_t>(producers) * perProducer * (perProducer + 1) / 2;
+    if (checksum != expected) {
+        cerr << "checksum mismatch: " << checksum << " != " << expected << "\n";
+    }
+    return total / seconds / 1e6;
+}
+
+double runLocked(size_t producers, size_t items) {
+    threadSafeQueue<uint64_t> queue;
+    return runThreads(producers, items,
+        [&queue](uint64_t first, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                queue.push(first + i);
+            }
+        },
+        [&queue](uint64_t& checksum) -> size_t {
+            uint64_t value;
+            if (!queue.tryPop(value)) {
+                return 0;
+            }
+            checksum += value;
+            return 1;
+        });
+}
+
+double runMpmc(size_t producers, size_t items, size_t capacity) {
+    MpmcQueue<uint64_t> queue(capacity);
+    return runThreads(producers, items,
+        [&queue](uint64_t first, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                while (!queue.tryPush(first + i)) {
+                    this_thread::yield();
+                }
+            }
+        },
+        [&queue](uint64_t& checksum) -> size_t {
+            uint64_t value;
+            if (!queue.tryPop(value)) {
+                return 0;
+            }
+            checksum += value;
+            return 1;
+        });
+}
+
+double runBulk(size_t producers, size_t items, size_t capacity) {
+    MpmcQueue<uint64_t> queue(capacity);
+    return runThreads(producers, items,
+        [&queue](uint64_t first, size_t count) {
+            array<uint64_t, BULK_SIZE> batch;
+            for (size_t i = 0; i < count; ) {
+                size_t size = min(BULK_SIZE, count - i);
+                for (size_t j = 0; j < size; ++j) {
+                    batch[j] = first + i + j;
+                }
+                for (size_t pushed = 0; pushed < size; ) {
+                    size_t added = queue.tryPushBulk(batch.begin() + pushed, size - pushed);
+                    if (added == 0) {
+                        this_thread::yield();
+                    }
+                    pushed += added;
+                }
+                i += size;
+            }
+        },
+        [&queue](uint64_t& checksum) {
+            array<uint64_t, BULK_SIZE> batch;
+            size_t taken = queue.tryPopBulk(batch.begin(), BULK_SIZE);
+            for (size_t i = 0; i < taken; ++i) {
+                checksum += batch[i];
+            }
+            return taken;
+        });
+}
+
+int main(int argc, const char* argv[]) {
+    size_t items = argc > 1 ? stoull(argv[1]) : DEFAULT_ITEMS;
+    size_t capacity = argc > 2 ? stoull(argv[2]) : DEFAULT_CAPACITY;
+
+    cout << "items: " << items << " queue capacity: " << capacity
+         << " hardware threads: " << thread::hardware_concurrency() << "\n";
+    cout << "producers/consumers  locked  mpmc  bulk  (Mops/s)\n";
+    for (size_t threads : THREAD_COUNTS) {
+        cout << threads << "/" << threads << "\t\t     " << runLocked(threads, items)
+             << "\t" << runMpmc(threads, items, capacity)
+             << "\t" << runBulk(threads, items, capacity) << "\n";
+    }
+    return 0;
+}
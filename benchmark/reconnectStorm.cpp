@@ -0,0 +1,197 @@
+// reconnectStorm - opens N client connections at once against a running chatServer
+// and measures how long it takes until every client is connected and served.
+//
+// Phase 1: N non-blocking connects are started back to back, the time at which
+//          each one completes is recorded (time-to-all-connected and percentiles).
+// Phase 2: one client sends a frame and the time until every other client received
+//          the broadcast is measured; this only completes once the server accepted
+//          and registered every connection, not just once the kernel finished the
+//          handshake into the listen backlog.
+//
+// Usage: reconnectStorm [host] [port] [clients]
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+constexpr int DEFAULT_CLIENTS = 10000;
+constexpr int WAIT_TIMEOUT_MS = 30000;
+constexpr int MAX_EVENTS = 1024;
+const string PROBE_MESSAGE{"storm"};
+
+struct Client {
+    int fd{-1};
+    bool connected{false};
+    size_t received{0};
+    Clock::duration connectTime{};
+};
+
+// raiseFileLimit - lifts RLIMIT_NOFILE to its hard limit so N sockets fit
+void raiseFileLimit(size_t needed) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < needed + 16) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+// percentile - value at fraction p of the sorted samples, in milliseconds
+double percentile(const vector<Clock::duration>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = min(sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1)));
+    return chrono::duration<double, milli>(sorted[index]).count();
+}
+
+double elapsedMs(Clock::time_point start) {
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+int main(int argc, const char* argv[]) {
+    string host = argc > 1 ? argv[1] : "127.0.0.1";
+    string port = argc > 2 ? argv[2] : "8080";
+    int clientCount = argc > 3 ? stoi(argv[3]) : DEFAULT_CLIENTS;
+    if (clientCount < 2) {
+        cerr << "At least 2 clients are needed\n";
+        return 1;
+    }
+    raiseFileLimit(clientCount);
+
+    struct addrinfo hints{};
+    struct addrinfo* address = nullptr;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &address) != 0) {
+        cerr << "Failed to resolve " << host << ":" << port << "\n";
+        return 1;
+    }
+
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    vector<Client> clients(clientCount);
+    int pending = 0;
+    Clock::time_point start = Clock::now();
+
+    for (int i = 0; i < clientCount; ++i) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd == -1) {
+            cerr << "socket failed after " << i << " clients: " << strerror(errno) << "\n";
+            return 1;
+        }
+        clients[i].fd = fd;
+        if (connect(fd, address->ai_addr, address->ai_addrlen) == 0) {
+            clients[i].connected = true;
+            clients[i].connectTime = Clock::now() - start;
+            continue;
+        }
+        if (errno != EINPROGRESS) {
+            cerr << "connect failed after " << i << " clients: " << strerror(errno) << "\n";
+            return 1;
+        }
+        struct epoll_event event{};
+        event.events = EPOLLOUT;
+        event.data.u32 = i;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+        ++pending;
+    }
+    freeaddrinfo(address);
+
+    int failed = 0;
+    vector<struct epoll_event> events(MAX_EVENTS);
+    while (pending > 0) {
+        int nfds = epoll_wait(epollFd, events.data(), MAX_EVENTS, WAIT_TIMEOUT_MS);
+        if (nfds <= 0) {
+            cerr << "Timed out with " << pending << " connects pending\n";
+            return 1;
+        }
+        for (int i = 0; i < nfds; ++i) {
+            Client& client = clients[events[i].data.u32];
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(client.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, client.fd, nullptr);
+            --pending;
+            if (error != 0) {
+                ++failed;
+                continue;
+            }
+            client.connected = true;
+            client.connectTime = Clock::now() - start;
+        }
+    }
+    double connectedMs = elapsedMs(start);
+
+    vector<Clock::duration> samples;
+    for (const auto& client : clients) {
+        if (client.connected) {
+            samples.push_back(client.connectTime);
+        }
+    }
+    sort(samples.begin(), samples.end());
+    cout << "clients: " << clientCount << " connected: " << samples.size() << " failed: " << failed << "\n";
+    cout << "time-to-all-connected: " << connectedMs << " ms\n";
+    cout << "connect p50: " << percentile(samples, 0.50) << " ms p90: " << percentile(samples, 0.90)
+         << " ms p99: " << percentile(samples, 0.99) << " ms max: " << percentile(samples, 1.0) << " ms\n";
+    if (failed > 0) {
+        return 1;
+    }
+
+    // Phase 2: every other client has to receive the probe frame
+    for (int i = 1; i < clientCount; ++i) {
+        struct epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u32 = i;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, clients[i].fd, &event);
+    }
+    string length = to_string(PROBE_MESSAGE.size());
+    string frame = string(4 - length.size(), '0') + length + PROBE_MESSAGE;
+    Clock::time_point probeStart = Clock::now();
+    if (send(clients[0].fd, frame.data(), frame.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(frame.size())) {
+        cerr << "Failed to send the probe frame\n";
+        return 1;
+    }
+
+    int waiting = clientCount - 1;
+    char buffer[256];
+    while (waiting > 0) {
+        int nfds = epoll_wait(epollFd, events.data(), MAX_EVENTS, WAIT_TIMEOUT_MS);
+        if (nfds <= 0) {
+            cerr << "Timed out with " << waiting << " clients still waiting for the probe\n";
+            return 1;
+        }
+        for (int i = 0; i < nfds; ++i) {
+            Client& client = clients[events[i].data.u32];
+            ssize_t bytesRead;
+            while ((bytesRead = recv(client.fd, buffer, sizeof(buffer), 0)) > 0) {
+                client.received += bytesRead;
+            }
+            if (bytesRead == 0 || client.received >= frame.size()) {
+                epoll_ctl(epollFd, EPOLL_CTL_DEL, client.fd, nullptr);
+                --waiting;
+            }
+        }
+    }
+    cout << "time-to-all-served: " << elapsedMs(probeStart) << " ms (probe broadcast to "
+         << clientCount - 1 << " clients), total: " << elapsedMs(start) << " ms\n";
+
+    for (const auto& client : clients) {
+        close(client.fd);
+    }
+    close(epollFd);
+    return 0;
+}
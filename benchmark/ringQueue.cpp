@@ -0,0 +1,119 @@
+// ringQueue - producer to sender hand-off throughput, the SequencedRing of the
+// sender shards against the mutex and condition variable queue it replaced.
+//
+// Every producer pushes its share of the items, a single consumer drains them
+// the way a sender shard does: the queue pops under the lock, the ring takes
+// every published entry in one batch. Each run is repeated for 1, 4 and 16
+// producers and every ring wait strategy.
+//
+// Usage: ringQueue [items] [ring capacity]
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../utils/sequencedRing.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+constexpr size_t DEFAULT_ITEMS = 2000000;
+constexpr size_t DEFAULT_CAPACITY = 16384;
+constexpr size_t PRODUCER_COUNTS[] = {1, 4, 16};
+
+// LockedQueue - the std::queue, mutex and condition variable hand-off
+class LockedQueue {
+    queue<uint64_t> m_Queue;
+    mutex m_Mutex;
+    condition_variable m_Cv;
+
+public:
+    void push(uint64_t value) {
+        {
+            lock_guard lock(m_Mutex);
+            m_Queue.push(value);
+        }
+        m_Cv.notify_one();
+    }
+
+    uint64_t waitAndPop() {
+        unique_lock lock(m_Mutex);
+        m_Cv.wait(lock, [this] { return !m_Queue.empty(); });
+        uint64_t value = m_Queue.front();
+        m_Queue.pop();
+        return value;
+    }
+};
+
+// runProducers - starts the producers, each pushing items / producers values,
+// and consumes everything on the calling thread
+// Returns the throughput in millions of items per second
+template<typename Push, typename Consume>
+double runProducers(size_t producers, size_t items, Push push, Consume consume) {
+    size_t perProducer = items / producers;
+    size_t total = perProducer * producers;
+    Clock::time_point start = Clock::now();
+    vector<jthread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&push, perProducer] {
+            for (size_t i = 0; i < perProducer; ++i) {
+                push(i + 1);
+            }
+        });
+    }
+    uint64_t checksum = consume(total);
+    threads.clear();
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+    uint64_t expected = static_cast<uint64_t>(producers) * perProducer * (perProducer + 1) / 2;
+    if (checksum != expected) {
+        cerr << "checksum mismatch: " << checksum << " != " << expected << "\n";
+    }
+    return total / seconds / 1e6;
+}
+
+double runLockedQueue(size_t producers, size_t items) {
+    LockedQueue queue;
+    return runProducers(producers, items,
+        [&queue](uint64_t value) { queue.push(value); },
+        [&queue](size_t total) {
+            uint64_t checksum = 0;
+            for (size_t i = 0; i < total; ++i) {
+                checksum += queue.waitAndPop();
+            }
+            return checksum;
+        });
+}
+
+double runRing(size_t producers, size_t items, size_t capacity, WaitStrategy::Mode mode) {
+    SequencedRing<uint64_t> ring(capacity, mode);
+    return runProducers(producers, items,
+        [&ring](uint64_t value) { ring.push(value); },
+        [&ring](size_t total) {
+            uint64_t checksum = 0;
+            for (size_t consumed = 0; consumed < total; ) {
+                consumed += ring.waitAndDrain([&checksum](uint64_t&& value) { checksum += value; });
+            }
+            return checksum;
+        });
+}
+
+int main(int argc, const char* argv[]) {
+    size_t items = argc > 1 ? stoull(argv[1]) : DEFAULT_ITEMS;
+    size_t capacity = argc > 2 ? stoull(argv[2]) : DEFAULT_CAPACITY;
+
+    cout << "items: " << items << " ring capacity: " << capacity
+         << " hardware threads: " << thread::hardware_concurrency() << "\n";
+    cout << "producers  queue+mutex  ring/spin  ring/yield  ring/block  (Mops/s)\n";
+    for (size_t producers : PRODUCER_COUNTS) {
+        cout << producers << "\t   " << runLockedQueue(producers, items)
+             << "\t" << runRing(producers, items, capacity, WaitStrategy::SPIN)
+             << "\t" << runRing(producers, items, capacity, WaitStrategy::YIELD)
+             << "\t" << runRing(producers, items, capacity, WaitStrategy::BLOCK) << "\n";
+    }
+    return 0;
+}
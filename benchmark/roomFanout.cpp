@@ -0,0 +1,96 @@
+// roomFanout - cost of resolving the recipients of one message, room delivery
+// against the delivery to every connected client.
+//
+// Connections are simulated by descriptor numbers only, so the benchmark runs
+// at a scale (100k clients over 1k rooms by default) that a single test host
+// cannot open as real sockets. Every message visits its recipient list the way
+// ChatServer::queueFrame does and counts the recipients.
+//
+// Usage: roomFanout [clients] [rooms] [messages]
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "../chatserver/roomRegistry.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+constexpr int DEFAULT_CLIENTS = 100000;
+constexpr int DEFAULT_ROOMS = 1000;
+constexpr int DEFAULT_MESSAGES = 10000;
+constexpr int FIRST_FD = 16;
+
+// visitRecipients - visits every recipient except the sender, like queueFrame
+template<typename Recipients>
+size_t visitRecipients(const Recipients& recipients, int senderFd) {
+    size_t count = 0;
+    for (int sd : recipients) {
+        if (sd != senderFd) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+int main(int argc, const char* argv[]) {
+    int clientCount = argc > 1 ? stoi(argv[1]) : DEFAULT_CLIENTS;
+    int roomCount = argc > 2 ? stoi(argv[2]) : DEFAULT_ROOMS;
+    int messageCount = argc > 3 ? stoi(argv[3]) : DEFAULT_MESSAGES;
+
+    vector<string> roomNames;
+    for (int i = 0; i < roomCount; ++i) {
+        roomNames.push_back("room" + to_string(i));
+    }
+
+    RoomRegistry registry;
+    unordered_set<int> clients;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < clientCount; ++i) {
+        int sd = FIRST_FD + i;
+        clients.insert(sd);
+        registry.join(roomNames[i % roomCount], sd);
+    }
+    double joinMs = chrono::duration<double, milli>(Clock::now() - start).count();
+    cout << "clients: " << clientCount << " rooms: " << registry.roomCount() << " messages: " << messageCount << "\n";
+    cout << "join: " << joinMs << " ms (" << joinMs * 1e6 / clientCount << " ns per join)\n";
+
+    mt19937 random(42);
+    uniform_int_distribution<int> pickClient(0, clientCount - 1);
+    vector<int> senders(messageCount);
+    for (auto& sender : senders) {
+        sender = FIRST_FD + pickClient(random);
+    }
+
+    size_t roomRecipients = 0;
+    start = Clock::now();
+    for (int senderFd : senders) {
+        const string& room = roomNames[(senderFd - FIRST_FD) % roomCount];
+        if (registry.isMember(room, senderFd)) {
+            roomRecipients += visitRecipients(*registry.members(room), senderFd);
+        }
+    }
+    double roomNs = chrono::duration<double, nano>(Clock::now() - start).count() / messageCount;
+
+    size_t allRecipients = 0;
+    start = Clock::now();
+    for (int senderFd : senders) {
+        allRecipients += visitRecipients(clients, senderFd);
+    }
+    double allNs = chrono::duration<double, nano>(Clock::now() - start).count() / messageCount;
+
+    cout << "room delivery: " << roomNs << " ns per message, " << roomRecipients / messageCount << " recipients per message\n";
+    cout << "all clients:   " << allNs << " ns per message, " << allRecipients / messageCount << " recipients per message\n";
+    cout << "speedup: " << allNs / roomNs << "x\n";
+
+    start = Clock::now();
+    for (int i = 0; i < clientCount; ++i) {
+        registry.leaveAll(FIRST_FD + i);
+    }
+    double leaveMs = chrono::duration<double, milli>(Clock::now() - start).count();
+    cout << "leaveAll: " << leaveMs << " ms, rooms left: " << registry.roomCount() << "\n";
+    return 0;
+}
@@ -0,0 +1,160 @@
+// threadPoolScaling - task throughput of the work-stealing ThreadPool against the
+// single mutex and condition variable queue it replaced, for 1 worker up to every
+// hardware thread.
+//
+// Two workloads:
+//   inject  one external thread enqueues every task, like the epoll loop does
+//   spawn   a few root tasks each enqueue a tree of child tasks from the workers
+// Every task does a little arithmetic so the numbers show queueing overhead,
+// not an empty loop.
+//
+// Usage: threadPoolScaling [tasks] [max workers, default every hardware thread]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../utils/threadPool.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+constexpr size_t DEFAULT_TASKS = 1000000;
+constexpr int TASK_WORK = 50;       // loop iterations per task
+constexpr size_t SPAWN_ROOTS = 64;  // root tasks of the spawn workload
+
+// LockedPool - the previous ThreadPool: one queue, one mutex, one condition variable
+class LockedPool {
+    vector<thread> m_Workers;
+    queue<function<void()>> m_Tasks;
+    mutex m_Mutex;
+    condition_variable m_Cv;
+    bool m_Stop{false};
+
+public:
+    explicit LockedPool(size_t threads) {
+        for (size_t i = 0; i < threads; ++i) {
+            m_Workers.emplace_back([this] {
+                while (true) {
+                    function<void()> task;
+                    {
+                        unique_lock lock(m_Mutex);
+                        m_Cv.wait(lock, [this] { return m_Stop || !m_Tasks.empty(); });
+                        if (m_Stop && m_Tasks.empty()) {
+                            return;
+                        }
+                        task = move(m_Tasks.front());
+                        m_Tasks.pop();
+                    }
+                    task();
+                }
+            });
+        }
+    }
+
+    ~LockedPool() {
+        {
+            lock_guard lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_Cv.notify_all();
+        for (thread& worker : m_Workers) {
+            worker.join();
+        }
+    }
+
+    void enqueue(function<void()> task) {
+        {
+            lock_guard lock(m_Mutex);
+            m_Tasks.push(move(task));
+        }
+        m_Cv.notify_one();
+    }
+};
+
+atomic<uint64_t> g_Sink{0};
+
+void work() {
+    uint64_t value = 1;
+    for (int i = 0; i < TASK_WORK; ++i) {
+        value = value * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    g_Sink.fetch_add(value & 1, memory_order_relaxed);
+}
+
+// waitDone - spins until every task ran
+void waitDone(const atomic<size_t>& done, size_t tasks) {
+    while (done.load(memory_order_acquire) < tasks) {
+        this_thread::yield();
+    }
+}
+
+// runInject - enqueues every task from the calling thread
+// Returns the throughput in millions of tasks per second
+template<typename Pool>
+double runInject(size_t threads, size_t tasks) {
+    Pool pool(threads);
+    atomic<size_t> done{0};
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < tasks; ++i) {
+        pool.enqueue([&done] { work(); done.fetch_add(1, memory_order_release); });
+    }
+    waitDone(done, tasks);
+    return tasks / chrono::duration<double>(Clock::now() - start).count() / 1e6;
+}
+
+// spawn - runs a task and enqueues its two children until budget tasks ran
+template<typename Pool>
+void spawn(Pool& pool, atomic<size_t>& done, size_t budget) {
+    work();
+    done.fetch_add(1, memory_order_release);
+    if (budget <= 1) {
+        return;
+    }
+    size_t left = budget - 1;
+    size_t half = left / 2;
+    if (half > 0) {
+        pool.enqueue([&pool, &done, half] { spawn(pool, done, half); });
+    }
+    pool.enqueue([&pool, &done, rest = left - half] { spawn(pool, done, rest); });
+}
+
+// runSpawn - a few root tasks, every other task is enqueued by a worker
+// Returns the throughput in millions of tasks per second
+template<typename Pool>
+double runSpawn(size_t threads, size_t tasks) {
+    Pool pool(threads);
+    atomic<size_t> done{0};
+    size_t perRoot = tasks / SPAWN_ROOTS;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < SPAWN_ROOTS; ++i) {
+        pool.enqueue([&pool, &done, perRoot] { spawn(pool, done, perRoot); });
+    }
+    waitDone(done, perRoot * SPAWN_ROOTS);
+    return perRoot * SPAWN_ROOTS / chrono::duration<double>(Clock::now() - start).count() / 1e6;
+}
+
+int main(int argc, const char* argv[]) {
+    size_t tasks = argc > 1 ? stoull(argv[1]) : DEFAULT_TASKS;
+    size_t hardware = argc > 2 ? stoull(argv[2]) : max(1u, thread::hardware_concurrency());
+
+    cout << "tasks: " << tasks << " hardware threads: " << hardware << "\n";
+    cout << "workers  inject/locked  inject/stealing  spawn/locked  spawn/stealing  (Mtasks/s)\n";
+    for (size_t threads = 1; ; threads = min(threads * 2, hardware)) {
+        cout << threads << "\t " << runInject<LockedPool>(threads, tasks)
+             << "\t\t" << runInject<ThreadPool>(threads, tasks)
+             << "\t\t " << runSpawn<LockedPool>(threads, tasks)
+             << "\t\t" << runSpawn<ThreadPool>(threads, tasks) << "\n";
+        if (threads == hardware) {
+            break;
+        }
+    }
+    return 0;
+}
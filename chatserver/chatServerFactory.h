@@ -3,20 +3,36 @@
 #include <string>
 
 #include "chatserver.h"
+#include "serverConfig.h"
 #ifdef _WIN32
         #include "handleConnectionsWindows.h"
 #else
         #include "handleConnectionsLinux.h"
+        #include "handleConnectionsMultiReactor.h"
+        #include "handleConnectionsIoUring.h"
 #endif
 using namespace std;
 struct chatServerFactory {
     inline static unique_ptr<ChatServer> getInstance(Logger &logger, 
                                                         const string& serverName, 
-                                                        const string& portNumber) {
+                                                        const string& portNumber,
+                                                        const ServerConfig& config = ServerConfig{}) {
 #ifdef _WIN32
         return make_unique<HandleConnectionsWindows>(logger, serverName, portNumber);
 #else
-        return make_unique<HandleConnectionsLinux>(logger, serverName, portNumber);
+        if (config.backend == ServerBackend::MULTI_REACTOR) {
+            return make_unique<HandleConnectionsMultiReactor>(logger, serverName, portNumber, config);
+        }
+        if (config.backend == ServerBackend::IO_URING) {
+            if (IoUring::isSupported()) {
+                return make_unique<HandleConnectionsIoUring>(logger, serverName, portNumber, config);
+            }
+            logger.log(LogLevel::Warning, "{}:io_uring is not supported by this kernel, using epoll", __func__);
+            ServerConfig fallback = config;
+            fallback.backend = ServerBackend::EPOLL;
+            return make_unique<HandleConnectionsLinux>(logger, serverName, portNumber, fallback);
+        }
+        return make_unique<HandleConnectionsLinux>(logger, serverName, portNumber, config);
 #endif
     }
 };
\ No newline at end of file
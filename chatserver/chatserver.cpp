@@ -15,14 +15,20 @@
 
 using namespace std;
 
-ChatServer::ChatServer(Logger& logger, const string& serverName, const string& port): 
-                          m_Logger(logger), m_ServerName(serverName), m_PortNumber(port)   
+ChatServer::ChatServer(Logger& logger, const string& serverName, const string& port, const ServerConfig& config): 
+                          m_Logger(logger), m_ServerName(serverName), m_PortNumber(port), m_Config(config)   
 {
     m_Logger.log(LogLevel::Info, "{}:ChatServer class created for {}:{}",__func__, serverName, port);
     m_IsConnected.store(true);
     threadBroadcastMessage();
 }
+
 bool ChatServer::createListner(){
+    m_Logger.log(LogLevel::Info, "{}:Staring chatServer", __func__);
+    return bindListener(m_Config.backend == ServerBackend::MULTI_REACTOR, m_SockfdListener);
+}
+
+bool ChatServer::bindListener(bool reusePort, decltype(m_SockfdListener)& listener){
     struct addrinfo hints{}, *ai = nullptr, *p = nullptr;
     char hostName[INET6_ADDRSTRLEN];
     char service[20];
@@ -34,7 +40,6 @@ bool ChatServer::createListner(){
     hints.ai_family = AF_UNSPEC;
     hints.ai_socktype = SOCK_STREAM;
     hints.ai_flags = AI_PASSIVE;
-    m_Logger.log(LogLevel::Info, "{}:Staring chatServer", __func__);
 
     if (getaddrinfo(m_ServerName.c_str(), m_PortNumber.c_str(), &hints, &ai) != 0) {
         m_Logger.log(LogLevel::Error, "{}:Getaddrinfo failed!",__func__);
@@ -44,33 +49,44 @@ bool ChatServer::createListner(){
     }
 
     for (p = ai; p != nullptr; p = p->ai_next) {
-        m_SockfdListener = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
-        if (m_SockfdListener < 0) {
+        listener = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+        if (listener < 0) {
             continue;
         }
         
         int optlen{sizeof(optval)};
-        if (setsockopt(m_SockfdListener, SOL_SOCKET, SO_REUSEADDR, &optval, optlen) < 0)
+        if (setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &optval, optlen) < 0)
         {
             m_Logger.log(LogLevel::Error, "{}:Setsockopt failed!",__func__);
             logLastError(m_Logger);
-            CLOSESOCKET(m_SockfdListener);
+            CLOSESOCKET(listener);
             continue;
         }
-        
+#ifdef SO_REUSEPORT
+        // Every reactor binds its own listener to the same port and the kernel
+        // spreads incoming connections across them
+        if (reusePort && setsockopt(listener, SOL_SOCKET, SO_REUSEPORT, &optval, optlen) < 0)
+        {
+            m_Logger.log(LogLevel::Error, "{}:Setsockopt SO_REUSEPORT failed!",__func__);
+            logLastError(m_Logger);
+            CLOSESOCKET(listener);
+            continue;
+        }
+#endif
 
-        if (bind(m_SockfdListener, p->ai_addr, p->ai_addrlen) != -1) {
+        if (bind(listener, p->ai_addr, p->ai_addrlen) != -1) {
             break; // Success
         }
         
         m_Logger.log(LogLevel::Error, "{}:Bind failed! Retrying...",__func__);
         logLastError(m_Logger);
-        CLOSESOCKET(m_SockfdListener);
+        CLOSESOCKET(listener);
     }
     
 
     if (p == nullptr) {
         m_Logger.log(LogLevel::Error, "{}:Failed to bind socket!",__func__);
+        freeaddrinfo(ai);
         return false;
     }
     m_Logger.log(LogLevel::Info, "{}:Server created and bound successfully.",__func__);
@@ -81,10 +97,11 @@ bool ChatServer::createListner(){
     }
     
     freeaddrinfo(ai); // all done with this
-    if (listen(m_SockfdListener, MAX_QUEUE_CONNECTINON) < 0)
+    if (listen(listener, m_Config.listenBacklog) < 0)
     {
         m_Logger.log(LogLevel::Error, "{}:Listen failed!",__func__);
         logLastError(m_Logger);
+        CLOSESOCKET(listener);
         return false;
     }
     m_Logger.log(LogLevel::Info, "{}:Server name:{} Port:{}",__func__, hostName, m_PortNumber);
@@ -106,27 +123,48 @@ void ChatServer::closeAllClientSockets()
 {
     m_Logger.log(LogLevel::Debug, "{}:All client sockets closed.",__func__);    
     lock_guard lock(m_Mutex);
-    for (const auto &sd : m_ClientSockets){
+    for (int sd : m_Clients){
         CLOSESOCKET(sd);
     }
-    m_ClientSockets.clear();
+    m_Clients.clear();
+}
+
+bool ChatServer::addClient(int sd, const struct sockaddr_storage* peer)
+{
+    struct sockaddr_storage sockAddr{};
+    if (!peer) {
+        socklen_t sockAddrLen = sizeof(sockAddr);
+        getpeername(sd, (struct sockaddr *)&sockAddr, &sockAddrLen);
+        peer = &sockAddr;
+    }
+    lock_guard lock(m_Mutex);
+    if (!m_Clients.add(sd, peer)) {
+        m_Logger.log(LogLevel::Error, "{}:Socket fd {} cannot be added to the connection table.", __func__, sd);
+        return false;
+    }
+    return true;
 }
 
 bool ChatServer::getClientIP(int sd )
 {
-    char ip[INET6_ADDRSTRLEN];
-    int port;
     struct sockaddr_storage sockAddr;
     socklen_t sockAddrLen = sizeof(sockAddr);
     memset(&sockAddr, 0, sizeof(sockAddr));
-    const char *ipVer;
     if (getpeername(sd, (struct sockaddr *)&sockAddr, &sockAddrLen) != 0)
     {
         m_Logger.log(LogLevel::Error, "{}:Getpeername failed!",__func__);
         logLastError(m_Logger);
         return false;
     }
-    
+    getClientIP(sockAddr);
+    return true;
+}
+
+void ChatServer::getClientIP(const struct sockaddr_storage& sockAddr)
+{
+    char ip[INET6_ADDRSTRLEN];
+    int port;
+    const char *ipVer;
     if (sockAddr.ss_family == AF_INET) {
         struct sockaddr_in *s = (struct sockaddr_in *)&sockAddr;
         port = ntohs(s->sin_port);
@@ -139,31 +177,16 @@ bool ChatServer::getClientIP(int sd )
         ipVer = "IPV6:";
     }
     m_Logger.log(LogLevel::Info, "{}:{}:{} Socket: {}",__func__,  ipVer, ip, port);
-    return true;
-}
-
-bool ChatServer::sendMessage(int sd, const string_view message)
-{
-    string length_str = to_string(message.length());
-    string padded_length_str = string(4 - length_str.length(), '0') + length_str;
-    string full_message = padded_length_str + string(message);
-
-    size_t bytesSent = send(sd, full_message.data(), full_message.length(), 0);
-    if (bytesSent < 0)
-    {
-        m_Logger.log(LogLevel::Error, "{}:Send to client failed!",__func__);
-        logLastError(m_Logger);
-        return false;
-    }
-    return true;
 }
 
+#ifdef _WIN32
 void ChatServer::threadBroadcastMessage() {
     m_Logger.log(LogLevel::Debug, "{}: Broadcast thread started.", __func__);
 
     m_BroadcastThread = jthread([this](stop_token token) {
         while (!token.stop_requested()) {
-            pair<int, string> front;
+            pair<ConnectionHandle, SharedFrame> front;
+            WireVersion version;
 
             {
                 unique_lock lock(m_BroadcastMutex);
@@ -178,58 +201,618 @@ void ChatServer::threadBroadcastMessage() {
                     
                 front = move(m_BroadcastMessageQueue.front());
                 m_BroadcastMessageQueue.pop();
+                // The socket of a client closed since the frame was queued may
+                // already belong to a new client
+                if (!m_Clients.isCurrent(front.first)) {
+                    continue;
+                }
+                if (front.second->type == FrameType::HELLO) {
+                    m_WireVersions[front.first.sd] = WireVersion::BINARY;
+                }
+                auto it = m_WireVersions.find(front.first.sd);
+                version = it != m_WireVersions.end() ? it->second : WireVersion::ASCII;
             }
 
-            if (front.first > 0) {
-                int sd = front.first;
-                string message = move(front.second); 
-                sendProdcastMessage(sd, message);
+            if (!front.second->fits(version)) {
+                m_Logger.log(LogLevel::Debug, "{}: Frame not supported by the framing of client:{}", __func__, front.first.sd);
+                continue;
+            }
+            // A failed client is skipped, never retried: waiting on it would
+            // delay the delivery to every other client
+            if (!sendMessage(front.first.sd, *front.second, version)) {
+                m_Logger.log(LogLevel::Error, "{}: Failed to send message to client:{}", __func__, front.first.sd);
             }
         }
         m_Logger.log(LogLevel::Debug, "{}: Broadcast thread stopped", __func__);
     });
 }
 
-void ChatServer::sendProdcastMessage(int sd, const string& message){
-    int tries = 0;
-    while(tries < 5)
+void ChatServer::wakeBroadcastThread() {
+    m_Cv.notify_one();
+}
+
+bool ChatServer::sendMessage(int sd, const BroadcastFrame& frame, WireVersion version)
+{
+    // Header and payload go out in one call, without building a framed copy
+    string_view header = frame.headerFor(version);
+    WSABUF buffers[2];
+    buffers[0].buf = const_cast<char*>(header.data());
+    buffers[0].len = static_cast<ULONG>(header.size());
+    buffers[1].buf = const_cast<char*>(frame.payload.data());
+    buffers[1].len = static_cast<ULONG>(frame.payload.length());
+    DWORD bytesSent = 0;
+    if (WSASend(sd, buffers, 2, &bytesSent, 0, nullptr, nullptr) == SOCKET_ERROR)
     {
-        if (sendMessage(sd, message)) {
-            //m_Logger.log(LogLevel::Debug, "{}: sd:{} Sent message to client:{}", __func__, sd, message);
-            m_Logger.log(LogLevel::Debug, "{}: sd:{} Sent message to client", __func__, sd);
+        m_Logger.log(LogLevel::Error, "{}:Send to client failed!",__func__);
+        logLastError(m_Logger);
+        return false;
+    }
+    return true;
+}
+
+void ChatServer::queueFrameTo(int sd, SharedFrame frame) {
+    ConnectionHandle client = m_Clients.handle(sd);
+    lock_guard lock(m_BroadcastMutex);
+    m_BroadcastMessageQueue.emplace(client, move(frame));
+    wakeBroadcastThread();
+}
+
+template<typename Recipients>
+void ChatServer::queueFrame(const SharedFrame& frame, const Recipients& recipients, int senderFd) {
+    lock_guard broadcastLock(m_BroadcastMutex);
+    for (const auto& recipient : recipients) {
+        ConnectionHandle client = m_Clients.handle(recipient);
+        if (client.sd != senderFd) {
+            m_BroadcastMessageQueue.emplace(client, frame);
+        }
+    }
+    wakeBroadcastThread();
+}
+#else
+void ChatServer::threadBroadcastMessage() {
+    if (m_Config.backend == ServerBackend::IO_URING) {
+        return; // the io_uring loop queues its own sends
+    }
+    size_t senderCount = m_Config.senderCount;
+    if (senderCount == 0) {
+        senderCount = max<size_t>(1, thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < senderCount; ++i) {
+        auto sender = make_unique<SenderShard>(m_Config.ringCapacity, m_Config.ringWait);
+        sender->id = i;
+        sender->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        sender->eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        sender->timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        sender->iov.resize(batchMaxFrames() * 2);
+        struct epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = sender->eventFd;
+        struct epoll_event timerEvent{};
+        timerEvent.events = EPOLLIN;
+        timerEvent.data.fd = sender->timerFd;
+        if (sender->epollFd == -1 || sender->eventFd == -1 || sender->timerFd == -1 ||
+            epoll_ctl(sender->epollFd, EPOLL_CTL_ADD, sender->eventFd, &event) == -1 ||
+            epoll_ctl(sender->epollFd, EPOLL_CTL_ADD, sender->timerFd, &timerEvent) == -1) {
+            m_Logger.log(LogLevel::Error, "{}: Failed to create the epoll instance of sender {}.", __func__, i);
+            logLastError(m_Logger);
+            for (int fd : {sender->eventFd, sender->timerFd, sender->epollFd}) {
+                if (fd != -1) {
+                    CLOSESOCKET(fd);
+                }
+            }
+            setIsConnected(false);
+            return;
+        }
+        m_Senders.push_back(move(sender));
+    }
+    // Threads start once every shard exists, senderFor never sees a partial vector
+    for (auto& sender : m_Senders) {
+        SenderShard& shard = *sender;
+        shard.thread = jthread([this, &shard](stop_token token) { runSender(shard, token); });
+    }
+    m_Logger.log(LogLevel::Debug, "{}: {} sender threads started.", __func__, senderCount);
+}
+
+SenderShard& ChatServer::senderFor(int sd) {
+    return *m_Senders[static_cast<size_t>(sd) % m_Senders.size()];
+}
+
+void ChatServer::runSender(SenderShard& sender, stop_token token) {
+    stop_callback wakeOnStop(token, [&sender] {
+        uint64_t one = 1;
+        write(sender.eventFd, &one, sizeof(one));
+    });
+    vector<struct epoll_event> events(max(1, m_Config.epollBatchSize));
+    while (!token.stop_requested()) {
+        int nfds = epoll_wait(sender.epollFd, events.data(), static_cast<int>(events.size()), -1);
+        if (nfds == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            m_Logger.log(LogLevel::Error, "{}: Sender {} failed to wait for events.", __func__, sender.id);
+            logLastError(m_Logger);
             break;
-        } else {
-            m_Logger.log(LogLevel::Error, "{}: Failed to send message to client:{}", __func__, sd);
-            m_Logger.log(LogLevel::Info, "{}: Trying again in 0,5 seconds...", __func__);
-            this_thread::sleep_for(chrono::milliseconds(500));
         }
-        tries++;
+        for (int i = 0; i < nfds; ++i) {
+            if (events[i].data.fd == sender.eventFd || events[i].data.fd == sender.timerFd) {
+                onSenderWakeup(sender, events[i].data.fd == sender.timerFd);
+            } else {
+                // Writable again, or an error that the next send reports
+                flushOutbound(sender, events[i].data.fd);
+            }
+        }
+    }
+    m_Logger.log(LogLevel::Debug, "{}: Sender {} stopped", __func__, sender.id);
+}
+
+size_t ChatServer::batchMaxFrames() const {
+    return clamp<size_t>(m_Config.batchMaxFrames, 1, MAX_WRITEV_FRAMES);
+}
+
+void ChatServer::wakeSender(SenderShard& sender, size_t pending) {
+    // One eventfd write per batch: producers queue many messages per wakeup.
+    // A second one cuts a coalescing wait short once a full batch is pending.
+    bool signal = !sender.wakePending.exchange(true);
+    if (!signal && pending >= batchMaxFrames() && !sender.batchFull.load(memory_order_relaxed)) {
+        signal = !sender.batchFull.exchange(true);
+    }
+    if (signal) {
+        uint64_t one = 1;
+        write(sender.eventFd, &one, sizeof(one));
+    }
+}
+
+size_t ChatServer::pushToSender(SenderShard& sender, ShardEntry entry) {
+    return sender.ring.push(move(entry), [this, &sender] { wakeSender(sender, batchMaxFrames()); });
+}
+
+void ChatServer::onSenderWakeup(SenderShard& sender, bool timerExpired) {
+    uint64_t count;
+    read(timerExpired ? sender.timerFd : sender.eventFd, &count, sizeof(count));
+    if (timerExpired) {
+        sender.timerArmed = false;
+    } else if (m_Config.batchMaxLatencyUs > 0 && !sender.timerArmed) {
+        if (sender.ring.size() < batchMaxFrames()) {
+            // Give the burst batchMaxLatencyUs to fill the batch before writing
+            struct itimerspec timeout{};
+            timeout.it_value.tv_sec = m_Config.batchMaxLatencyUs / 1000000;
+            timeout.it_value.tv_nsec = (m_Config.batchMaxLatencyUs % 1000000) * 1000;
+            if (timerfd_settime(sender.timerFd, 0, &timeout, nullptr) == 0) {
+                sender.timerArmed = true;
+                return;
+            }
+        }
+    } else if (sender.timerArmed) {
+        // A full batch arrived before the timer expired
+        struct itimerspec disarm{};
+        timerfd_settime(sender.timerFd, 0, &disarm, nullptr);
+        sender.timerArmed = false;
+    }
+    takeBroadcastMessages(sender);
+}
+
+void ChatServer::takeBroadcastMessages(SenderShard& sender) {
+    // Reset before draining: an entry published after the drain signals again.
+    // The exchange acquires the wake of the producers that saw it set.
+    sender.wakePending.exchange(false);
+    sender.batchFull.exchange(false);
+
+    // Group by destination: every client gets all its new frames in one flush.
+    // A close is only seen after every frame queued before it, the frames of a
+    // closed client are dropped without a write.
+    sender.ring.drain([this, &sender](ShardEntry&& entry) {
+        int sd = entry.client.sd;
+        if (!entry.frame) {
+            dropOutbound(sender, sd);
+            CLOSESOCKET(sd);
+            return;
+        }
+        if (!m_Clients.isCurrent(entry.client)) {
+            return;
+        }
+        OutboundQueue& outbound = sender.outbound[sd];
+        outbound.generation = entry.client.generation;
+        if (entry.frame->type == FrameType::HELLO) {
+            if (outbound.version == WireVersion::ASCII) {
+                outbound.asciiFrames = outbound.frames.size();
+            }
+            outbound.version = WireVersion::BINARY;
+        } else if (!entry.frame->fits(outbound.version)) {
+            m_Logger.log(LogLevel::Debug, "{}: Frame not supported by the framing of client:{}", __func__, sd);
+            return;
+        }
+        if (outbound.frames.empty()) {
+            sender.ready.push_back(sd);
+        }
+        outbound.frames.push_back(move(entry.frame));
+    });
+    for (int sd : sender.ready) {
+        flushOutbound(sender, sd);
+    }
+    sender.ready.clear();
+}
+
+void ChatServer::flushOutbound(SenderShard& sender, int sd) {
+    auto it = sender.outbound.find(sd);
+    if (it == sender.outbound.end()) {
+        return;
+    }
+    OutboundQueue& outbound = it->second;
+    struct iovec* iov = sender.iov.data();
+    size_t maxFrames = sender.iov.size() / 2;
+    // Checked before every write: once the client closed, the rest of its queue is dropped
+    while (!outbound.frames.empty() && m_Clients.isCurrent(ConnectionHandle{sd, outbound.generation})) {
+        // Gather the header and payload of the pending frames, skipping the
+        // part of the first frame that an earlier call already wrote
+        size_t iovCount = 0;
+        size_t skip = outbound.offset;
+        for (size_t i = 0; i < outbound.frames.size() && i < maxFrames; ++i) {
+            const BroadcastFrame& frame = *outbound.frames[i];
+            string_view header = frame.headerFor(outbound.versionOf(i));
+            if (skip < header.size()) {
+                iov[iovCount].iov_base = const_cast<char*>(header.data() + skip);
+                iov[iovCount].iov_len = header.size() - skip;
+                ++iovCount;
+                skip = 0;
+            } else {
+                skip -= header.size();
+            }
+            if (frame.payload.size() > skip) {
+                iov[iovCount].iov_base = const_cast<char*>(frame.payload.data() + skip);
+                iov[iovCount].iov_len = frame.payload.size() - skip;
+                ++iovCount;
+            }
+            skip = 0;
+        }
+        struct msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovCount;
+        ssize_t bytesSent = sendmsg(sd, &msg, MSG_NOSIGNAL);
+        if (bytesSent >= 0) {
+            size_t remaining = outbound.offset + bytesSent;
+            while (!outbound.frames.empty()) {
+                size_t frameSize = frameHeaderSize(outbound.versionOf(0)) + outbound.frames.front()->payload.size();
+                if (remaining < frameSize) {
+                    break;
+                }
+                remaining -= frameSize;
+                outbound.frames.pop_front();
+                if (outbound.asciiFrames > 0) {
+                    --outbound.asciiFrames;
+                }
+            }
+            outbound.offset = remaining;
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            // Socket buffer full: resume on EPOLLOUT, the other clients keep going
+            if (!outbound.waitingWritable) {
+                struct epoll_event event{};
+                event.events = EPOLLOUT | EPOLLET;
+                event.data.fd = sd;
+                if (epoll_ctl(sender.epollFd, EPOLL_CTL_ADD, sd, &event) == 0) {
+                    outbound.waitingWritable = true;
+                    return;
+                }
+                m_Logger.log(LogLevel::Error, "{}: Failed to wait for socket fd {} to become writable.", __func__, sd);
+                break;
+            }
+            return;
+        }
+        // The peer is gone, the read side closes the socket
+        m_Logger.log(LogLevel::Error, "{}: Failed to send message to client:{}", __func__, sd);
+        logLastError(m_Logger);
+        break;
+    }
+    outbound.frames.clear();
+    outbound.offset = 0;
+    outbound.asciiFrames = 0;
+    if (outbound.waitingWritable) {
+        epoll_ctl(sender.epollFd, EPOLL_CTL_DEL, sd, nullptr);
+        outbound.waitingWritable = false;
+    }
+}
+
+void ChatServer::dropOutbound(SenderShard& sender, int sd) {
+    auto it = sender.outbound.find(sd);
+    if (it == sender.outbound.end()) {
+        return;
+    }
+    if (it->second.waitingWritable) {
+        epoll_ctl(sender.epollFd, EPOLL_CTL_DEL, sd, nullptr);
+    }
+    sender.outbound.erase(it);
+}
+template<typename Recipients>
+void ChatServer::queueFrame(const SharedFrame& frame, const Recipients& recipients, int senderFd) {
+    if (m_Senders.empty()) {
+        return;
+    }
+    // Recipients are grouped per shard so every shard is woken once
+    thread_local vector<vector<ConnectionHandle>> shardRecipients;
+    shardRecipients.resize(m_Senders.size());
+    for (const auto& recipient : recipients) {
+        ConnectionHandle client = m_Clients.handle(recipient);
+        if (client.sd != senderFd) {
+            shardRecipients[static_cast<size_t>(client.sd) % m_Senders.size()].push_back(client);
+        }
+    }
+    for (size_t i = 0; i < m_Senders.size(); ++i) {
+        if (shardRecipients[i].empty()) {
+            continue;
+        }
+        SenderShard& sender = *m_Senders[i];
+        size_t pending = 0;
+        for (ConnectionHandle client : shardRecipients[i]) {
+            pending = pushToSender(sender, ShardEntry{client, frame});
+        }
+        wakeSender(sender, pending);
+        shardRecipients[i].clear();
+    }
+}
+
+void ChatServer::queueFrameTo(int sd, SharedFrame frame) {
+    if (m_Senders.empty()) {
+        return;
+    }
+    SenderShard& sender = senderFor(sd);
+    wakeSender(sender, pushToSender(sender, ShardEntry{m_Clients.handle(sd), move(frame)}));
+}
+#endif
+
+const vector<ConnectionHandle>& ChatServer::recipientHandles(const vector<int>& fds) const {
+    thread_local vector<ConnectionHandle> handles;
+    handles.clear();
+    for (int sd : fds) {
+        handles.push_back(m_Clients.handle(sd));
     }
+    return handles;
 }
+
 void ChatServer::addProadcastMessage(int sd, const string& message) {
+    queueFrameTo(sd, make_shared<const BroadcastFrame>(message));
+}
+
+void ChatServer::broadcastMessage(int senderFd, string_view message) {
+    // Framed once, every recipient only takes a reference. The recipients are
+    // read from a snapshot, accepts, closes and other broadcasts are not blocked.
+    auto frame = make_shared<const BroadcastFrame>(message);
+    queueFrame(frame, m_Clients.recipients(), senderFd);
+}
+
+void ChatServer::publishMessage(int senderFd, string_view room, string_view message) {
+    const vector<ConnectionHandle>* recipients;
     {
-        lock_guard lock(m_BroadcastMutex);
-        m_BroadcastMessageQueue.emplace(make_pair(sd, message));
+        lock_guard lock(m_Mutex);
+        const vector<int>* members = m_Rooms.members(room);
+        if (!members || !binary_search(members->begin(), members->end(), senderFd)) {
+            m_Logger.log(LogLevel::Warning, "{}:Socket fd {} is not a member of room {}", __func__, senderFd, room);
+            return;
+        }
+        // Only the members of the room are visited, not every connected client
+        recipients = &recipientHandles(*members);
     }
-    m_Cv.notify_one();
-}   
+    auto frame = make_shared<const BroadcastFrame>(message);
+    queueFrame(frame, *recipients, senderFd);
+}
+
+void ChatServer::handleMessage(int senderFd, string_view message, FrameType type, uint16_t flags) {
+    if (Connection* conn = m_Clients.find(senderFd)) {
+        conn->messagesReceived.fetch_add(1, memory_order_relaxed);
+        conn->bytesReceived.fetch_add(message.length(), memory_order_relaxed);
+    }
+    if (type == FrameType::HELLO) {
+        // The answer switches the queue of senderFd to binary frames, the
+        // frames queued before it still go out in ASCII
+        m_Logger.log(LogLevel::Debug, "{}:Socket fd {} negotiated binary frames", __func__, senderFd);
+        queueFrameTo(senderFd, make_shared<const BroadcastFrame>(string_view{}, FrameType::HELLO));
+        return;
+    }
+    if (type == FrameType::CHUNK) {
+        handleChunk(senderFd, message, flags);
+        return;
+    }
+    if (type != FrameType::MESSAGE) {
+        m_Logger.log(LogLevel::Warning, "{}:Unknown frame type {} from socket fd {}", __func__, static_cast<int>(type), senderFd);
+        return;
+    }
+    RoomCommand command = parseRoomCommand(message);
+    switch (command.type) {
+        case RoomCommand::JOIN: {
+            lock_guard lock(m_Mutex);
+            m_Rooms.join(command.room, senderFd);
+            m_Logger.log(LogLevel::Debug, "{}:Socket fd {} joined room {}", __func__, senderFd, command.room);
+            break;
+        }
+        case RoomCommand::LEAVE: {
+            lock_guard lock(m_Mutex);
+            m_Rooms.leave(command.room, senderFd);
+            m_Logger.log(LogLevel::Debug, "{}:Socket fd {} left room {}", __func__, senderFd, command.room);
+            break;
+        }
+        case RoomCommand::PUBLISH:
+            publishMessage(senderFd, command.room, command.text);
+            break;
+        case RoomCommand::INVALID:
+            m_Logger.log(LogLevel::Warning, "{}:Invalid room command from socket fd {}", __func__, senderFd);
+            break;
+        default:
+            broadcastMessage(senderFd, message);
+            break;
+    }
+}
+
+void ChatServer::handleChunk(int senderFd, string_view chunk, uint16_t flags) {
+    if (chunk.length() < STREAM_ID_SIZE) {
+        m_Logger.log(LogLevel::Warning, "{}:Invalid chunk from socket fd {}", __func__, senderFd);
+        return;
+    }
+    // The client stream id is not forwarded: a client streams one message at a
+    // time and the recipients see an id unique across all the senders
+    string_view data = chunk.substr(STREAM_ID_SIZE);
+    bool last = (flags & FRAME_FLAG_LAST) != 0;
+    SharedFrame frame; // released after m_Mutex, its window may resume a sender
+    const vector<ConnectionHandle>* recipients;
+    {
+        lock_guard lock(m_Mutex);
+        auto it = m_Streams.find(senderFd);
+        if (it == m_Streams.end()) {
+            InboundStream stream{m_NextStreamId++, {}, make_shared<StreamWindow>(m_Config.streamWindowBytes)};
+            RoomCommand command = parseRoomCommand(data);
+            if (command.type == RoomCommand::PUBLISH) {
+                if (!m_Rooms.isMember(command.room, senderFd)) {
+                    m_Logger.log(LogLevel::Warning, "{}:Socket fd {} is not a member of room {}", __func__, senderFd, command.room);
+                } else {
+                    stream.recipients = *m_Rooms.members(command.room);
+                }
+                data = command.text; // the recipients get the text, not the command
+            } else {
+                stream.recipients.assign(m_Clients.begin(), m_Clients.end());
+            }
+            m_Logger.log(LogLevel::Debug, "{}:Socket fd {} streams to {} clients", __func__, senderFd, stream.recipients.size());
+            it = m_Streams.emplace(senderFd, move(stream)).first;
+        }
+        InboundStream& stream = it->second;
+        frame = make_shared<const BroadcastFrame>(stream.id, data, last ? FRAME_FLAG_LAST : 0, stream.window);
+        recipients = &recipientHandles(stream.recipients);
+        if (last) {
+            m_Streams.erase(it);
+        }
+    }
+    // Pushed without m_Mutex, a full ring must not block the other clients
+    queueFrame(frame, *recipients, senderFd);
+}
+
+void ChatServer::endStreams(int sd, SharedFrame& abort, vector<ConnectionHandle>& recipients) {
+    auto it = m_Streams.find(sd);
+    if (it != m_Streams.end()) {
+        abort = make_shared<const BroadcastFrame>(it->second.id, string_view{}, FRAME_FLAG_ABORT, nullptr);
+        recipients = recipientHandles(it->second.recipients);
+        m_Streams.erase(it);
+    }
+    for (auto& [senderFd, stream] : m_Streams) {
+        erase(stream.recipients, sd);
+    }
+}
+
+bool ChatServer::pauseStream(int sd, function<void()> resume) {
+    shared_ptr<StreamWindow> window;
+    {
+        lock_guard lock(m_Mutex);
+        auto it = m_Streams.find(sd);
+        if (it == m_Streams.end()) {
+            return false;
+        }
+        window = it->second.window;
+    }
+    return window->pause(move(resume));
+}
 
 void ChatServer::closeSocket(int sd)
 {
+    SharedFrame abort;
+    vector<ConnectionHandle> abortRecipients;
+#ifndef _WIN32
+    bool removed;
+    ConnectionHandle client;
+    {
+        lock_guard lock(m_Mutex);
+        endStreams(sd, abort, abortRecipients);
+        m_Rooms.leaveAll(sd);
+        logClosedClient(sd);
+        client = m_Clients.handle(sd);
+        removed = m_Clients.remove(sd);
+    }
+    // Pushed without m_Mutex, a full ring must not block the other clients
+    if (abort) {
+        queueFrame(abort, abortRecipients, sd);
+    }
+    if (removed && !m_Senders.empty()) {
+        // No message can be queued for sd any more, hand the close to its
+        // sender shard behind the messages already queued. Frames other threads
+        // push after it carry a stale handle and are dropped by the shard.
+        SenderShard& sender = senderFor(sd);
+        wakeSender(sender, pushToSender(sender, ShardEntry{client, nullptr}));
+        m_Logger.log(LogLevel::Debug, "{}:Socket closed.",__func__);
+        return;
+    }
     CLOSESOCKET(sd);
-    lock_guard lock(m_Mutex);
-    m_ClientSockets.erase(sd);
+#else
+    // Forgotten before the close, Windows can hand the socket number to the next client
+    {
+        lock_guard lock(m_Mutex);
+        endStreams(sd, abort, abortRecipients);
+        m_Rooms.leaveAll(sd);
+        logClosedClient(sd);
+        m_Clients.remove(sd);
+    }
+    {
+        lock_guard lock(m_BroadcastMutex);
+        m_WireVersions.erase(sd);
+    }
+    CLOSESOCKET(sd);
+    if (abort) {
+        queueFrame(abort, abortRecipients, sd);
+    }
+#endif
     m_Logger.log(LogLevel::Debug, "{}:Socket closed.",__func__);
 }
 
-unordered_set<int> ChatServer::getClientSockets() const {
-    return m_ClientSockets;
+void ChatServer::logClosedClient(int sd) {
+    Connection* conn = m_Clients.find(sd);
+    if (conn) {
+        m_Logger.log(LogLevel::Debug, "{}:Socket fd {} received {} messages, {} bytes", __func__, sd,
+                     conn->messagesReceived.load(memory_order_relaxed), conn->bytesReceived.load(memory_order_relaxed));
+    }
+}
+
+vector<int> ChatServer::getClientSockets() {
+    lock_guard lock(m_Mutex);
+    return vector<int>(m_Clients.begin(), m_Clients.end());
 }
 
 ChatServer::~ChatServer(){
     CLOSESOCKET(m_SockfdListener);
     setIsConnected(false);
+#ifdef _WIN32
+    // Joined here, the thread reads m_Clients which is destroyed before it
     m_BroadcastThread.request_stop();
+    {
+        lock_guard lock(m_BroadcastMutex);
+        wakeBroadcastThread();
+    }
+    if (m_BroadcastThread.joinable()) {
+        m_BroadcastThread.join();
+    }
+#else
+    stopSenders();
+#endif
     m_Logger.log(LogLevel::Debug, "{}:ChatServer class destroyed.",__func__);
     m_Logger.setDone(true);
-}
\ No newline at end of file
+}
+
+#ifndef _WIN32
+void ChatServer::stopSenders(){
+    for (auto& sender : m_Senders) {
+        sender->thread.request_stop();
+        if (sender->thread.joinable()) {
+            sender->thread.join();
+        }
+        // Sockets released after the shard stopped. The frames dropped here may
+        // resume a paused stream, on this thread.
+        sender->ring.drain([](ShardEntry&& entry) {
+            if (!entry.frame) {
+                CLOSESOCKET(entry.client.sd);
+            }
+        });
+        sender->outbound.clear();
+        CLOSESOCKET(sender->eventFd);
+        CLOSESOCKET(sender->timerFd);
+        CLOSESOCKET(sender->epollFd);
+    }
+    m_Senders.clear();
+}
+#endif
\ No newline at end of file
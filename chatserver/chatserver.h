@@ -1,9 +1,12 @@
 #pragma once
 
 #include <string_view>
+#include <algorithm>
 #include <atomic>
+#include <deque>
+#include <memory>
 #include <queue>
-#include <unordered_set>
+#include <unordered_map>
 #include <mutex>
 #include <thread>
 #include <iostream>
@@ -19,6 +22,9 @@
     #include <sys/socket.h>
     #include <sys/types.h>
     #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <sys/timerfd.h>
+    #include <sys/uio.h>
     #include <netinet/in.h>
     typedef void *HANDLE;
     typedef unsigned long long SOCKET;
@@ -27,13 +33,115 @@
 
 #include "../utils/logger.h"
 #include "../utils/util.h"
+#include "../utils/wireFrame.h"
+#include "../utils/sequencedRing.h"
+#include "serverConfig.h"
+#include "roomRegistry.h"
+#include "streamWindow.h"
+#include "connectionTable.h"
 
 using namespace std;
 
 constexpr int MAX_THREAD{4};
 constexpr int MAX_PORT_TRIES{10};
-constexpr int MAX_QUEUE_CONNECTINON{10};
 constexpr int BUFFER_SIZE{1024};
+constexpr size_t MAX_WRITEV_FRAMES{512}; // upper bound of ServerConfig::batchMaxFrames, two iovecs per frame
+
+// BroadcastFrame - a message framed once and shared, never copied, by every
+// recipient queue. It is freed when the last recipient has written it.
+// Both framings are encoded up front, a recipient writes the header of its own.
+struct BroadcastFrame {
+    FrameType type;
+    FrameHeader header;              // ASCII framing, meaningless when the payload exceeds MAX_FRAME_PAYLOAD
+    BinaryFrameHeader binaryHeader;
+    string payload;
+    shared_ptr<StreamWindow> window; // chunks only, released when the last recipient is done
+
+    BroadcastFrame(string_view message, FrameType frameType = FrameType::MESSAGE)
+        : type(frameType), header(encodeFrameHeader(min(message.length(), MAX_FRAME_PAYLOAD))),
+          binaryHeader(encodeBinaryFrameHeader(message.length(), frameType)), payload(message) {}
+
+    // Constructor of a CHUNK frame
+    // streamId: stream id seen by the recipients
+    // data: chunk data
+    // flags: FRAME_FLAG_LAST or FRAME_FLAG_ABORT on the final chunk
+    // streamWindow: window of the stream, null for an abort
+    BroadcastFrame(uint32_t streamId, string_view data, uint16_t flags, shared_ptr<StreamWindow> streamWindow)
+        : type(FrameType::CHUNK), header(encodeFrameHeader(0)),
+          binaryHeader(encodeBinaryFrameHeader(STREAM_ID_SIZE + data.length(), FrameType::CHUNK, flags)),
+          payload(STREAM_ID_SIZE, '\0'), window(move(streamWindow)) {
+        encodeStreamId(streamId, payload.data());
+        payload.append(data);
+        if (window) {
+            window->acquire(payload.length());
+        }
+    }
+
+    ~BroadcastFrame() {
+        if (window) {
+            window->release(payload.length());
+        }
+    }
+
+    // headerFor - header bytes of the frame in the framing of a recipient
+    string_view headerFor(WireVersion version) const {
+        return version == WireVersion::BINARY ? string_view(binaryHeader.bytes, BINARY_FRAME_HEADER_SIZE)
+                                              : string_view(header.bytes, FRAME_HEADER_SIZE);
+    }
+
+    // fits - whether the framing of a recipient can carry the frame, ASCII only carries messages
+    bool fits(WireVersion version) const {
+        return version == WireVersion::BINARY || (type == FrameType::MESSAGE && payload.length() <= MAX_FRAME_PAYLOAD);
+    }
+};
+using SharedFrame = shared_ptr<const BroadcastFrame>;
+
+#ifndef _WIN32
+// OutboundQueue - frames waiting to be written to one client, owned by its sender shard
+struct OutboundQueue {
+    deque<SharedFrame> frames;
+    size_t offset{0};             // bytes of frames.front(), header included, already sent
+    bool waitingWritable{false};  // registered for EPOLLOUT in the shard epoll instance
+    uint32_t generation{0};       // generation of the client the frames are for
+    WireVersion version{WireVersion::ASCII}; // switched to BINARY by the HELLO answer
+    size_t asciiFrames{0};                   // frames at the front queued before the switch, still sent in ASCII
+
+    // versionOf - framing of frames[index]
+    WireVersion versionOf(size_t index) const {
+        return index < asciiFrames ? WireVersion::ASCII : version;
+    }
+};
+
+// ShardEntry - one slot of a sender ring: a frame for a client, or, with a null
+// frame, the close of the client. The shard closes the socket after dropping its
+// outbound queue, so a descriptor is never reused while frames for the old client
+// are pending. Frames for a client that closed meanwhile are dropped by generation.
+struct ShardEntry {
+    ConnectionHandle client;
+    SharedFrame frame;
+};
+
+// SenderShard - one sender worker with its own epoll instance and eventfd. Every
+// client is hashed to one shard, so its frames are always written by the same
+// thread and in the order they were queued.
+struct SenderShard {
+    size_t id{0};
+    int epollFd{-1};
+    int eventFd{-1};
+    int timerFd{-1};                      // ends the coalescing wait of ServerConfig::batchMaxLatencyUs
+    SequencedRing<ShardEntry> ring;       // filled by the handlers, drained by the shard thread
+    atomic<bool> wakePending{false};      // eventFd already signalled
+    atomic<bool> batchFull{false};        // eventFd signalled again because the ring holds a full batch
+    // Owned by the shard thread
+    unordered_map<int, OutboundQueue> outbound;
+    bool timerArmed{false};
+    vector<int> ready;
+    vector<struct iovec> iov;
+    jthread thread; // declared last so it is joined before the queues are destroyed
+
+    SenderShard(size_t ringCapacity, WaitStrategy::Mode ringWait) : ring(ringCapacity, ringWait) {}
+};
+#endif
 
 class ChatServer {
     protected:
@@ -46,45 +154,175 @@ class ChatServer {
 #endif
         string m_ServerName;
         string m_PortNumber;
+        ServerConfig m_Config;
+
+        // bindListener - creates a socket bound and listening on m_ServerName:m_PortNumber
+        // reusePort: set SO_REUSEPORT so several listeners can share the same port
+        // listener: output parameter that receives the listening socket
+        // Returns true if successful, false otherwise
+        bool bindListener(bool reusePort, decltype(m_SockfdListener)& listener);
     private:
         atomic<bool> m_IsConnected{false};
+#ifdef _WIN32
         condition_variable m_Cv;
         mutex m_BroadcastMutex;
-        
-        // sendMessage - sends a message to the specified client socket
+
+        // wakeBroadcastThread - signals the broadcast thread, m_BroadcastMutex must be held
+        void wakeBroadcastThread();
+
+        // sendMessage - sends a frame to the specified client socket
+        // sd: the socket descriptor of the client
+        // frame: the frame to be sent
+        // version: framing of the client
+        bool sendMessage(int sd, const BroadcastFrame& frame, WireVersion version);
+#else
+        vector<unique_ptr<SenderShard>> m_Senders;
+
+        // senderFor - the sender shard owning a client, chosen by fd hash
         // sd: the socket descriptor of the client
-        // message: the message to be sent
-        bool sendMessage(int sd, const string_view message);
+        SenderShard& senderFor(int sd);
+
+        // runSender - event loop of a sender shard, runs until the server is destroyed
+        // sender: the shard owning the loop
+        // token: stop token of the shard thread
+        void runSender(SenderShard& sender, stop_token token);
+
+        // batchMaxFrames - ServerConfig::batchMaxFrames clamped to [1, MAX_WRITEV_FRAMES]
+        size_t batchMaxFrames() const;
+
+        // wakeSender - signals a sender shard after entries were pushed to its ring
+        // sender: the shard to wake
+        // pending: ring entries pending, as returned by the last push
+        void wakeSender(SenderShard& sender, size_t pending);
 
-        // threadBroadcastMessage - processes messages from the read message queue
+        // pushToSender - pushes an entry to the ring of a shard. A push that finds the
+        // ring full wakes the shard before waiting, as a full batch: the shard drains
+        // only when signalled.
+        // sender: the shard owning the ring
+        // entry: the frame or close marker to push
+        // Returns the ring entries pending, to pass to wakeSender
+        size_t pushToSender(SenderShard& sender, ShardEntry entry);
+
+        // onSenderWakeup - drains the shard at once, or when batchMaxLatencyUs is set
+        // waits until a full batch is pending or the latency budget has elapsed
+        // sender: the shard woken up
+        // timerExpired: the wakeup comes from the shard timerfd
+        void onSenderWakeup(SenderShard& sender, bool timerExpired);
+
+        // takeBroadcastMessages - drains the shard ring into the outbound queues in one
+        // batch, writes every destination once and closes the sockets released by the
+        // handlers
+        // sender: the shard owning the queues
+        void takeBroadcastMessages(SenderShard& sender);
+
+        // flushOutbound - writes the outbound queue of a client, up to batchMaxFrames
+        // frames per sendmsg, until it is empty or the socket reports EAGAIN, in which
+        // case EPOLLOUT interest is registered
+        // sender: the shard owning the client
+        // sd: the socket descriptor of the client
+        void flushOutbound(SenderShard& sender, int sd);
+
+        // dropOutbound - discards the outbound queue of a client and its EPOLLOUT interest
+        // sender: the shard owning the client
+        // sd: the socket descriptor of the client
+        void dropOutbound(SenderShard& sender, int sd);
+#endif
+
+        // threadBroadcastMessage - starts the threads writing the queued messages to the clients
         void threadBroadcastMessage();
-        // sendProdcastMessage - continuously sends broadcast messages to a client
+
+        // queueFrame - queues a frame to every recipient except the sender. Never call it
+        // with m_Mutex held: a full sender ring blocks the push. Pass a snapshot of
+        // m_Clients or handles copied under m_Mutex with recipientHandles.
+        // frame: the shared frame
+        // recipients: range of socket descriptors or connection handles
+        // senderFd: the socket descriptor of the client that sent the message
+        template<typename Recipients>
+        void queueFrame(const SharedFrame& frame, const Recipients& recipients, int senderFd);
+
+        // queueFrameTo - queues a frame to a single client
         // sd: the socket descriptor of the client
-        // message: the message to be sent
-        void sendProdcastMessage(int sd, const string& message);
+        // frame: the shared frame
+        void queueFrameTo(int sd, SharedFrame frame);
+
+        // handleChunk - forwards one chunk of the stream of senderFd to the recipients
+        // chosen at its first chunk: the other members of a room for a /pub, else every client
+        // senderFd: the socket descriptor of the client streaming
+        // chunk: the CHUNK payload, stream id included
+        // flags: the chunk flags, FRAME_FLAG_LAST ends the stream
+        void handleChunk(int senderFd, string_view chunk, uint16_t flags);
+
+        // recipientHandles - the handles of the clients connected on fds, m_Mutex must be held.
+        // Taken under the lock, so a descriptor reused by a new client once it is
+        // released does not receive the frame.
+        // fds: socket descriptors guarded by m_Mutex, like the members of a room
+        // Returns a vector owned by the calling thread, valid until its next call
+        const vector<ConnectionHandle>& recipientHandles(const vector<int>& fds) const;
+
+        // endStreams - ends the stream of a closed client and removes it from the
+        // recipients of the other streams, m_Mutex must be held. The caller queues the
+        // abort frame once m_Mutex is released.
+        // sd: the socket descriptor of the closed client
+        // abort: output parameter that receives the abort frame, null if sd was not streaming
+        // recipients: output parameter that receives the recipients of the abort frame
+        void endStreams(int sd, SharedFrame& abort, vector<ConnectionHandle>& recipients);
 
     protected:
+#ifdef _WIN32
         jthread m_BroadcastThread;
-        queue<pair<int, string>> m_BroadcastMessageQueue;
-        unordered_set<int> m_ClientSockets;
+        queue<pair<ConnectionHandle, SharedFrame>> m_BroadcastMessageQueue;
+        unordered_map<int, WireVersion> m_WireVersions; // binary clients, guarded by m_BroadcastMutex
+#endif
+        ConnectionTable m_Clients; // connected clients, guarded by m_Mutex
+        RoomRegistry m_Rooms;      // guarded by m_Mutex, like m_Clients
+        // InboundStream - a message streamed by a client, forwarded chunk by chunk
+        struct InboundStream {
+            uint32_t id;                     // stream id seen by the recipients
+            vector<int> recipients;          // chosen at the first chunk
+            shared_ptr<StreamWindow> window;
+        };
+        unordered_map<int, InboundStream> m_Streams; // open stream per sender socket, guarded by m_Mutex
+        uint32_t m_NextStreamId{1};                  // guarded by m_Mutex
         vector<jthread> m_Threads;
         mutex m_Mutex;
+
+        // addClient - registers an accepted client in m_Clients
+        // sd: the socket descriptor of the client
+        // peer: the peer address returned by accept, nullptr to query it with getpeername
+        // Returns false if sd cannot be tracked, the caller closes it
+        bool addClient(int sd, const struct sockaddr_storage* peer = nullptr);
+
+        // logClosedClient - logs the counters of a client being closed, m_Mutex must be held
+        // sd: the socket descriptor of the client
+        void logClosedClient(int sd);
+#ifndef _WIN32
+
+        // stopSenders - joins the sender shards and drops the frames they still hold.
+        // Their threads run the resume callbacks of paused streams, so a backend calls
+        // it before it destroys what those callbacks use, once nothing queues frames.
+        void stopSenders();
+#endif
     public:
         Logger& m_Logger;
         // Constructor
         // logger: reference to Logger instance for logging
         // serverName: the server hostname or IP address
         // portNumber: the port number to bind the server socket
-        ChatServer(Logger &logger, const string& serverName, const string& portNumber);
+        // config: runtime options for the server
+        ChatServer(Logger &logger, const string& serverName, const string& portNumber, const ServerConfig& config = ServerConfig{});
         
-        // Destructor
-        ~ChatServer();
+        // Destructor - virtual, the factory hands out the backends as ChatServer
+        virtual ~ChatServer();
 
         // getClientIP - retrieves and prints the connected client's IP address and port
         // sd: the socket descriptor of the connected client
         // Returns true if successful, false otherwise
         bool getClientIP(int sd);
 
+        // getClientIP - prints the IP address and port returned by accept, without a getpeername call
+        // sockAddr: the peer address filled by accept
+        void getClientIP(const struct sockaddr_storage& sockAddr);
+
         // getIsConnected - returns the connection status
         bool getIsConnected() const;
         
@@ -95,21 +333,50 @@ class ChatServer {
         virtual void acceptConnections() = 0;
 
         // createListner - Initialize the server connection listner socket
+        // In MULTI_REACTOR mode the listener is created with SO_REUSEPORT
         bool createListner();
 
-        // closeSocket - closes the client socket 
+        // closeSocket - closes the client socket. On Linux a client socket is closed by
+        // its sender shard once its outbound queue has been dropped
         // sd: the socket descriptor 
         void closeSocket(int sd);
 
         // closeAllClientSockets - closes all connected client sockets
         void closeAllClientSockets();
 
-        // getClientSockets - returns the set of currently connected client sockets 
-        // Returns an unordered_set of client socket descriptors
-        unordered_set<int> getClientSockets() const;
+        // getClientSockets - returns the currently connected client sockets
+        // Returns a copy of the client socket descriptors, in no particular order
+        vector<int> getClientSockets();
 
         // addProadcastMessage - adds a message to the broadcast message queue
         // sd: the socket descriptor of the client to send the message to
         // message: the message to be broadcasted
         void addProadcastMessage(int sd, const string& message);
+
+        // broadcastMessage - frames a message once and queues it to every client except the sender
+        // senderFd: the socket descriptor of the client that sent the message
+        // message: the message payload, copied once into the shared frame
+        void broadcastMessage(int senderFd, string_view message);
+
+        // publishMessage - frames a message once and queues it to the other members of a room
+        // senderFd: the socket descriptor of the client that sent the message, it must be a member
+        // room: the room name
+        // message: the text of the /pub command, without the command and the room
+        void publishMessage(int senderFd, string_view room, string_view message);
+
+        // handleMessage - applies a received message: a room command (see RoomCommand)
+        // or plain chat broadcast to every client
+        // senderFd: the socket descriptor of the client that sent the message
+        // message: the message payload
+        // type: frame type, a HELLO switches the replies to senderFd to binary frames
+        // flags: frame flags
+        void handleMessage(int senderFd, string_view message, FrameType type = FrameType::MESSAGE, uint16_t flags = 0);
+
+        // pauseStream - checks the window of the stream sd is sending, called by a
+        // handler after the chunks of one read. When it returns true the handler must
+        // stop reading sd until resume is called.
+        // sd: the socket descriptor of the client
+        // resume: re-enables reading sd, may run on a sender thread
+        // Returns true if sd has to pause
+        bool pauseStream(int sd, function<void()> resume);
 };
@@ -0,0 +1,127 @@
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+
+#include "coReactor.h"
+
+constexpr int SUCCESS = 0;
+
+CoReactor::CoReactor(function<void(coroutine_handle<>)> schedule) : m_Schedule(move(schedule)) {
+}
+
+CoReactor::~CoReactor() {
+    if (m_TimerFd != -1) {
+        close(m_TimerFd);
+    }
+    if (m_EpollFd != -1) {
+        close(m_EpollFd);
+    }
+}
+
+int CoReactor::init() {
+    m_EpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_EpollFd == -1) {
+        return -errno;
+    }
+    m_TimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (m_TimerFd == -1) {
+        return -errno;
+    }
+    // The timerfd is the only entry without an awaiter behind data.ptr
+    struct epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    if (epoll_ctl(m_EpollFd, EPOLL_CTL_ADD, m_TimerFd, &event) == -1) {
+        return -errno;
+    }
+    return SUCCESS;
+}
+
+bool CoReactor::FdAwaiter::await_suspend(coroutine_handle<> handle) {
+    m_Handle = handle;
+    if (!m_Reactor.watch(*this)) {
+        m_Events = 0;
+        return false;
+    }
+    // Once watched the coroutine may already run on another thread, this awaiter
+    // must not be touched any more
+    return true;
+}
+
+bool CoReactor::watch(FdAwaiter& awaiter) {
+    struct epoll_event event{};
+    event.events = awaiter.m_Events | EPOLLONESHOT;
+    event.data.ptr = &awaiter;
+    int fd = awaiter.m_Fd;
+    // The fd stays registered, disabled, after its last one-shot event
+    if (epoll_ctl(m_EpollFd, EPOLL_CTL_MOD, fd, &event) == 0) {
+        return true;
+    }
+    return errno == ENOENT && epoll_ctl(m_EpollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+void CoReactor::SleepAwaiter::await_suspend(coroutine_handle<> handle) {
+    m_Reactor.addTimer(m_Deadline, handle);
+}
+
+void CoReactor::addTimer(Clock::time_point deadline, coroutine_handle<> handle) {
+    lock_guard lock(m_TimerMutex);
+    bool earliest = m_Timers.empty() || deadline < m_Timers.top().deadline;
+    m_Timers.push(Timer{deadline, handle});
+    if (earliest) {
+        armTimerFd();
+    }
+}
+
+void CoReactor::armTimerFd() {
+    struct itimerspec timeout{};
+    if (!m_Timers.empty()) {
+        auto since = m_Timers.top().deadline.time_since_epoch();
+        auto seconds = chrono::duration_cast<chrono::seconds>(since);
+        timeout.it_value.tv_sec = seconds.count();
+        timeout.it_value.tv_nsec = chrono::duration_cast<chrono::nanoseconds>(since - seconds).count();
+        if (timeout.it_value.tv_sec <= 0 && timeout.it_value.tv_nsec <= 0) {
+            timeout.it_value.tv_nsec = 1; // a zero value would disarm the timer
+        }
+    }
+    timerfd_settime(m_TimerFd, TFD_TIMER_ABSTIME, &timeout, nullptr);
+}
+
+void CoReactor::expireTimers() {
+    uint64_t expirations;
+    while (read(m_TimerFd, &expirations, sizeof(expirations)) == -1 && errno == EINTR) {
+    }
+    vector<coroutine_handle<>> ready;
+    {
+        lock_guard lock(m_TimerMutex);
+        Clock::time_point now = Clock::now();
+        while (!m_Timers.empty() && m_Timers.top().deadline <= now) {
+            ready.push_back(m_Timers.top().handle);
+            m_Timers.pop();
+        }
+        armTimerFd();
+    }
+    for (coroutine_handle<> handle : ready) {
+        m_Schedule(handle);
+    }
+}
+
+void CoReactor::poll() {
+    struct epoll_event events[POLL_BATCH];
+    int count;
+    do {
+        count = epoll_wait(m_EpollFd, events, POLL_BATCH, 0);
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.ptr == nullptr) {
+                expireTimers();
+                continue;
+            }
+            // The awaiter lives in the coroutine frame, it may be gone as soon
+            // as the coroutine is scheduled
+            FdAwaiter* awaiter = static_cast<FdAwaiter*>(events[i].data.ptr);
+            coroutine_handle<> handle = awaiter->m_Handle;
+            awaiter->m_Events = events[i].events;
+            m_Schedule(handle);
+        }
+    } while (count == POLL_BATCH);
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <sys/epoll.h>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+#include "../utils/coTask.h"
+
+using namespace std;
+
+// CoReactor - resumes coroutines suspended on a file descriptor or a timer. It
+// owns an epoll instance of its own plus a timerfd; that epoll descriptor is
+// registered in the server event loop, which calls poll() when it turns readable,
+// so waiting coroutines hold no thread. Ready coroutines are handed to the
+// schedule callback, the server resumes them on its thread pool.
+// An fd is watched with EPOLLONESHOT for one awaiting coroutine at a time.
+class CoReactor {
+public:
+    using Clock = chrono::steady_clock;
+
+    // FdAwaiter - co_await readable(fd) or writable(fd)
+    // Resumes with the epoll events that fired, or 0 if the fd could not be watched
+    class FdAwaiter {
+    public:
+        FdAwaiter(CoReactor& reactor, int fd, uint32_t events) : m_Reactor(reactor), m_Fd(fd), m_Events(events) {}
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(coroutine_handle<> handle);
+        uint32_t await_resume() const noexcept { return m_Events; }
+
+    private:
+        friend class CoReactor;
+        CoReactor& m_Reactor;
+        int m_Fd;
+        uint32_t m_Events;          // requested events, then the events that fired
+        coroutine_handle<> m_Handle;
+    };
+
+    // SleepAwaiter - co_await sleepFor(duration)
+    class SleepAwaiter {
+    public:
+        SleepAwaiter(CoReactor& reactor, Clock::time_point deadline) : m_Reactor(reactor), m_Deadline(deadline) {}
+
+        bool await_ready() const noexcept { return m_Deadline <= Clock::now(); }
+        void await_suspend(coroutine_handle<> handle);
+        void await_resume() const noexcept {}
+
+    private:
+        CoReactor& m_Reactor;
+        Clock::time_point m_Deadline;
+    };
+
+    // Constructor
+    // schedule: called from poll() with every coroutine ready to resume
+    explicit CoReactor(function<void(coroutine_handle<>)> schedule);
+
+    // Destructor - closes the descriptors, coroutines still waiting are never resumed
+    ~CoReactor();
+
+    CoReactor(const CoReactor&) = delete;
+    CoReactor& operator=(const CoReactor&) = delete;
+
+    // init - creates the epoll instance and the timerfd
+    // Returns 0 on success, -errno on failure
+    int init();
+
+    // fd - the epoll descriptor to watch for EPOLLIN in the server event loop
+    int fd() const { return m_EpollFd; }
+
+    // poll - schedules every coroutine whose fd or timer is ready, never blocks
+    void poll();
+
+    // readable - awaitable resumed once fd has data to read, or hung up
+    FdAwaiter readable(int fd) { return FdAwaiter(*this, fd, EPOLLIN | EPOLLRDHUP); }
+
+    // writable - awaitable resumed once fd accepts more data
+    FdAwaiter writable(int fd) { return FdAwaiter(*this, fd, EPOLLOUT); }
+
+    // sleepFor - awaitable resumed once duration elapsed
+    template<typename Rep, typename Period>
+    SleepAwaiter sleepFor(chrono::duration<Rep, Period> duration) {
+        return SleepAwaiter(*this, Clock::now() + chrono::duration_cast<Clock::duration>(duration));
+    }
+
+private:
+    struct Timer {
+        Clock::time_point deadline;
+        coroutine_handle<> handle;
+        bool operator>(const Timer& other) const { return deadline > other.deadline; }
+    };
+
+    static constexpr int POLL_BATCH{64};
+
+    function<void(coroutine_handle<>)> m_Schedule;
+    int m_EpollFd{-1};
+    int m_TimerFd{-1};
+    mutex m_TimerMutex;
+    priority_queue<Timer, vector<Timer>, greater<Timer>> m_Timers; // guarded by m_TimerMutex
+
+    // watch - arms fd for one awaiter
+    // Returns false if epoll refused the fd
+    bool watch(FdAwaiter& awaiter);
+
+    // addTimer - queues a sleeping coroutine and moves the timerfd earlier if needed
+    void addTimer(Clock::time_point deadline, coroutine_handle<> handle);
+
+    // expireTimers - schedules the coroutines whose deadline passed and re-arms the timerfd
+    void expireTimers();
+
+    // armTimerFd - sets the timerfd to the earliest deadline, requires m_TimerMutex
+    void armTimerFd();
+};
@@ -0,0 +1,130 @@
+#include "connectionTable.h"
+
+ConnectionTable::ConnectionTable() : m_Slabs(new atomic<Connection*>[MAX_CONNECTION_SLABS]),
+                                     m_Snapshot(new RecipientSnapshot) {
+    for (size_t i = 0; i < MAX_CONNECTION_SLABS; ++i) {
+        m_Slabs[i].store(nullptr, memory_order_relaxed);
+    }
+}
+
+ConnectionTable::~ConnectionTable() {
+    const RecipientSnapshot* snapshot = m_Snapshot.load(memory_order_relaxed);
+    for (const RecipientChunk* chunk : snapshot->chunks) {
+        delete chunk;
+    }
+    delete snapshot;
+}
+
+void ConnectionTable::publish(ConnectionHandle client, bool connected) {
+    const RecipientSnapshot* old = m_Snapshot.load(memory_order_relaxed);
+    auto snapshot = new RecipientSnapshot(*old);
+    size_t index = static_cast<size_t>(client.sd) / CONNECTION_SLAB_SIZE;
+    if (snapshot->chunks.size() <= index) {
+        snapshot->chunks.resize(index + 1, nullptr);
+    }
+    const RecipientChunk* oldChunk = snapshot->chunks[index];
+    auto chunk = oldChunk ? new RecipientChunk(*oldChunk) : new RecipientChunk;
+    if (connected) {
+        chunk->clients.push_back(client);
+    } else {
+        erase_if(chunk->clients, [&client](const ConnectionHandle& h) { return h.sd == client.sd; });
+    }
+    if (chunk->clients.empty()) {
+        delete chunk;
+        chunk = nullptr;
+    }
+    snapshot->chunks[index] = chunk;
+    m_Snapshot.store(snapshot, memory_order_release);
+    // Readers may still iterate the replaced ones
+    m_Epochs.retire(old);
+    if (oldChunk) {
+        m_Epochs.retire(oldChunk);
+    }
+}
+
+Connection* ConnectionTable::slot(int sd) {
+    size_t index = static_cast<size_t>(sd) / CONNECTION_SLAB_SIZE;
+    if (sd < 0 || index >= MAX_CONNECTION_SLABS) {
+        return nullptr;
+    }
+    Connection* slab = m_Slabs[index].load(memory_order_relaxed);
+    if (!slab) {
+        m_Owned.push_back(make_unique<Connection[]>(CONNECTION_SLAB_SIZE));
+        slab = m_Owned.back().get();
+        m_Slabs[index].store(slab, memory_order_release);
+    }
+    return &slab[static_cast<size_t>(sd) % CONNECTION_SLAB_SIZE];
+}
+
+Connection* ConnectionTable::add(int sd, const struct sockaddr_storage* peer) {
+    Connection* conn = slot(sd);
+    if (!conn || (conn->generation.load(memory_order_relaxed) & 1) != 0) {
+        return nullptr;
+    }
+    conn->denseIndex = static_cast<uint32_t>(m_Fds.size());
+    conn->peer = peer ? *peer : sockaddr_storage{};
+    conn->messagesReceived.store(0, memory_order_relaxed);
+    conn->bytesReceived.store(0, memory_order_relaxed);
+    uint32_t generation = conn->generation.fetch_add(1, memory_order_release) + 1;
+    m_Fds.push_back(sd);
+    publish(ConnectionHandle{sd, generation}, true);
+    return conn;
+}
+
+bool ConnectionTable::remove(int sd) {
+    Connection* conn = find(sd);
+    if (!conn) {
+        return false;
+    }
+    // Swap with the last descriptor so the live ones stay contiguous
+    int last = m_Fds.back();
+    m_Fds[conn->denseIndex] = last;
+    find(last)->denseIndex = conn->denseIndex;
+    m_Fds.pop_back();
+    conn->generation.fetch_add(1, memory_order_release);
+    publish(ConnectionHandle{sd, 0}, false);
+    return true;
+}
+
+Connection* ConnectionTable::find(int sd) const {
+    size_t index = static_cast<size_t>(sd) / CONNECTION_SLAB_SIZE;
+    if (sd < 0 || index >= MAX_CONNECTION_SLABS) {
+        return nullptr;
+    }
+    Connection* slab = m_Slabs[index].load(memory_order_acquire);
+    if (!slab) {
+        return nullptr;
+    }
+    Connection* conn = &slab[static_cast<size_t>(sd) % CONNECTION_SLAB_SIZE];
+    return (conn->generation.load(memory_order_acquire) & 1) != 0 ? conn : nullptr;
+}
+
+ConnectionHandle ConnectionTable::handle(int sd) const {
+    Connection* conn = find(sd);
+    return ConnectionHandle{sd, conn ? conn->generation.load(memory_order_relaxed) : 0};
+}
+
+bool ConnectionTable::isCurrent(ConnectionHandle handle) const {
+    // An even generation is never live, whatever the slot holds now
+    size_t index = static_cast<size_t>(handle.sd) / CONNECTION_SLAB_SIZE;
+    if ((handle.generation & 1) == 0 || handle.sd < 0 || index >= MAX_CONNECTION_SLABS) {
+        return false;
+    }
+    Connection* slab = m_Slabs[index].load(memory_order_acquire);
+    return slab && slab[static_cast<size_t>(handle.sd) % CONNECTION_SLAB_SIZE].generation.load(memory_order_acquire) == handle.generation;
+}
+
+void ConnectionTable::clear() {
+    for (int sd : m_Fds) {
+        slot(sd)->generation.fetch_add(1, memory_order_release);
+    }
+    m_Fds.clear();
+    const RecipientSnapshot* old = m_Snapshot.load(memory_order_relaxed);
+    m_Snapshot.store(new RecipientSnapshot, memory_order_release);
+    for (const RecipientChunk* chunk : old->chunks) {
+        if (chunk) {
+            m_Epochs.retire(chunk);
+        }
+    }
+    m_Epochs.retire(old);
+}
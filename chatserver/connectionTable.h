@@ -0,0 +1,170 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#ifdef _WIN32
+    #include <winsock2.h>
+#else
+    #include <sys/socket.h>
+#endif
+
+#include "../utils/epochDomain.h"
+
+using namespace std;
+
+constexpr size_t CONNECTION_SLAB_SIZE{1024};   // slots allocated at once
+constexpr size_t MAX_CONNECTION_SLABS{1024};   // descriptors up to 1M can be tracked
+
+// Connection - state of one connected client, the slot of its descriptor
+struct Connection {
+    atomic<uint32_t> generation{0};          // odd while connected, bumped on every connect and close
+    uint32_t denseIndex{0};                  // position of the descriptor in ConnectionTable::m_Fds
+    struct sockaddr_storage peer{};          // peer address returned by accept
+    atomic<uint64_t> messagesReceived{0};
+    atomic<uint64_t> bytesReceived{0};
+};
+
+// ConnectionHandle - a client as seen by queued work: its descriptor and the
+// generation of its slot when the work was queued. A descriptor reused by a new
+// client comes with another generation, so work left for the old one is dropped.
+struct ConnectionHandle {
+    int sd{-1};
+    uint32_t generation{0};
+};
+
+// RecipientChunk - the handles of the connected clients whose descriptors share one slab
+struct RecipientChunk {
+    vector<ConnectionHandle> clients;
+};
+
+// RecipientSnapshot - membership as published by one connect or close, never modified.
+// A change copies the chunk of its slab and the chunk list only, not every client.
+struct RecipientSnapshot {
+    vector<const RecipientChunk*> chunks; // indexed by slab, null when no client is in it
+};
+
+// ConnectionTable - the connected clients, indexed by socket descriptor. The kernel
+// hands out the lowest free descriptor, so the descriptors of the clients stay dense
+// and a slot is found by indexing, without hashing. Slots come from slabs of
+// CONNECTION_SLAB_SIZE that are never freed or moved: find needs no lock and the
+// address of a slot is stable. The live descriptors are also kept contiguous for
+// the broadcast loop. add, remove and iteration are not thread safe, the owner guards them.
+// Every add and remove also publishes a RecipientSnapshot, read by the fan-out
+// through Recipients without the owner lock.
+class ConnectionTable {
+private:
+    unique_ptr<atomic<Connection*>[]> m_Slabs; // MAX_CONNECTION_SLABS entries, null until used
+    vector<unique_ptr<Connection[]>> m_Owned;  // the allocated slabs
+    vector<int> m_Fds;                         // live descriptors, in no particular order
+    atomic<const RecipientSnapshot*> m_Snapshot;
+    mutable EpochDomain m_Epochs;              // frees the snapshots and chunks replaced
+
+    // slot - the slot of a descriptor, allocating its slab
+    // Returns nullptr if sd is beyond the table
+    Connection* slot(int sd);
+
+    // publish - publishes the snapshot with the membership of one descriptor changed
+    // client: the handle of the client connected or closed
+    // connected: true if the client was added, false if it was removed
+    void publish(ConnectionHandle client, bool connected);
+
+public:
+    // Recipients - the connected clients of the last snapshot, iterated as handles
+    // without the owner lock. The snapshot is kept alive while the object exists,
+    // hold it for one fan-out only.
+    class Recipients {
+    private:
+        EpochDomain::Guard m_Guard;
+        const RecipientSnapshot* m_Snapshot;
+
+    public:
+        class iterator {
+        private:
+            const RecipientSnapshot* m_Snapshot;
+            size_t m_Chunk;
+            size_t m_Index{0};
+
+            // skipEmpty - moves to the next chunk holding a client, or the end
+            void skipEmpty() {
+                while (m_Chunk < m_Snapshot->chunks.size() && !m_Snapshot->chunks[m_Chunk]) {
+                    ++m_Chunk;
+                }
+            }
+
+        public:
+            iterator(const RecipientSnapshot* snapshot, size_t chunk) : m_Snapshot(snapshot), m_Chunk(chunk) {
+                skipEmpty();
+            }
+
+            const ConnectionHandle& operator*() const { return m_Snapshot->chunks[m_Chunk]->clients[m_Index]; }
+
+            iterator& operator++() {
+                if (++m_Index == m_Snapshot->chunks[m_Chunk]->clients.size()) {
+                    m_Index = 0;
+                    ++m_Chunk;
+                    skipEmpty();
+                }
+                return *this;
+            }
+
+            bool operator==(const iterator& other) const { return m_Chunk == other.m_Chunk && m_Index == other.m_Index; }
+        };
+
+        explicit Recipients(const ConnectionTable& table)
+            : m_Guard(table.m_Epochs), m_Snapshot(table.m_Snapshot.load(memory_order_acquire)) {}
+
+        iterator begin() const { return iterator(m_Snapshot, 0); }
+        iterator end() const { return iterator(m_Snapshot, m_Snapshot->chunks.size()); }
+    };
+
+    ConnectionTable();
+    ~ConnectionTable();
+
+    // recipients - the connected clients, read without the owner lock. Clients
+    // closed since the snapshot was published are still listed, their handles are stale.
+    Recipients recipients() const { return Recipients(*this); }
+
+    // add - registers a connected client
+    // sd: the socket descriptor of the client
+    // peer: the peer address, nullptr if unknown
+    // Returns the slot, nullptr if sd is already registered or beyond the table
+    Connection* add(int sd, const struct sockaddr_storage* peer = nullptr);
+
+    // remove - unregisters a client
+    // sd: the socket descriptor of the client
+    // Returns false if sd was not registered
+    bool remove(int sd);
+
+    // find - the slot of a connected client, safe without the owner lock. Only the
+    // atomic fields may be read that way, the slot can be reused at any time.
+    // sd: the socket descriptor of the client
+    // Returns nullptr if sd is not connected
+    Connection* find(int sd) const;
+
+    // handle - the handle of the client currently connected on sd, safe without the owner lock
+    // sd: the socket descriptor of the client
+    // Returns a handle that is never current if sd is not connected
+    ConnectionHandle handle(int sd) const;
+
+    // handle - a handle as it is, lets a fan-out take descriptors and handles alike
+    ConnectionHandle handle(ConnectionHandle client) const { return client; }
+
+    // isCurrent - whether the client of a handle is still connected, safe without the owner lock
+    // handle: the handle taken when the work was queued
+    bool isCurrent(ConnectionHandle handle) const;
+
+    // contains - whether a client is connected
+    bool contains(int sd) const { return find(sd) != nullptr; }
+
+    // size - number of connected clients
+    size_t size() const { return m_Fds.size(); }
+
+    // Iteration over the live descriptors
+    vector<int>::const_iterator begin() const { return m_Fds.begin(); }
+    vector<int>::const_iterator end() const { return m_Fds.end(); }
+
+    // clear - unregisters every client, the slabs are kept
+    void clear();
+};
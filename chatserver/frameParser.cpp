@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <cstring>
+
+#include "frameParser.h"
+
+FrameParser::FrameParser() : m_Buffer(FRAME_PARSER_INITIAL_SIZE) {
+}
+
+char* FrameParser::writableSpace(size_t minSize) {
+    if (m_Buffer.size() - m_End >= minSize) {
+        return m_Buffer.data() + m_End;
+    }
+    // Move the partial frame to the front before growing
+    size_t pending = m_End - m_Begin;
+    if (m_Begin > 0) {
+        memmove(m_Buffer.data(), m_Buffer.data() + m_Begin, pending);
+        m_Begin = 0;
+        m_End = pending;
+    }
+    size_t needed = max(m_End + minSize, m_Begin + m_Expected);
+    if (m_Buffer.size() < needed) {
+        size_t newSize = m_Buffer.size();
+        while (newSize < needed) {
+            newSize *= 2;
+        }
+        m_Buffer.resize(newSize);
+    }
+    return m_Buffer.data() + m_End;
+}
+
+size_t FrameParser::writableSize() const {
+    return m_Buffer.size() - m_End;
+}
+
+void FrameParser::commit(size_t count) {
+    m_End += count;
+}
+
+void FrameParser::append(const char* data, size_t count) {
+    memcpy(writableSpace(count), data, count);
+    commit(count);
+}
+
+FrameParser::Result FrameParser::nextFrame(string_view& message) {
+    while (m_End - m_Begin >= m_Expected) {
+        const char* data = m_Buffer.data() + m_Begin;
+        if (!m_VersionKnown) {
+            m_Version = wireVersionOf(data[0]);
+            m_VersionKnown = true;
+            m_Expected = frameHeaderSize(m_Version);
+            continue;
+        }
+        if (m_State == READ_HEADER) {
+            FrameInfo info;
+            bool valid = m_Version == WireVersion::BINARY ? decodeBinaryFrameHeader(data, info)
+                                                          : decodeFrameHeader(data, info.length);
+            if (!valid) {
+                return BAD_HEADER;
+            }
+            m_Begin += m_Expected;
+            m_State = READ_BODY;
+            m_Expected = info.length;
+            m_FrameType = info.type;
+            m_FrameFlags = info.flags;
+            continue;
+        }
+        message = string_view(data, m_Expected);
+        m_Begin += m_Expected;
+        m_State = READ_HEADER;
+        m_Expected = frameHeaderSize(m_Version);
+        if (m_Begin == m_End) {
+            m_Begin = m_End = 0;
+        }
+        return FRAME;
+    }
+    return NEED_MORE;
+}
+
+FrameType FrameParser::frameType() const {
+    return m_FrameType;
+}
+
+uint16_t FrameParser::frameFlags() const {
+    return m_FrameFlags;
+}
+
+WireVersion FrameParser::getVersion() const {
+    return m_Version;
+}
+
+FrameParser::State FrameParser::getState() const {
+    return m_State;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "../utils/wireFrame.h"
+
+using namespace std;
+
+constexpr size_t FRAME_PARSER_INITIAL_SIZE{4096};
+
+// FrameParser - per-connection receive state machine for length prefixed frames.
+// Bytes are read straight into a growable buffer; every complete frame is
+// returned as a view into that buffer, so one read can yield many messages.
+// The first byte of the connection selects the ASCII or binary framing, a
+// connection cannot switch afterwards.
+class FrameParser {
+public:
+    enum State { READ_HEADER, READ_BODY };
+    enum Result { FRAME, NEED_MORE, BAD_HEADER };
+
+private:
+    vector<char> m_Buffer;
+    size_t m_Begin{0};   // first unparsed byte
+    size_t m_End{0};     // one past the last received byte
+    State m_State{READ_HEADER};
+    size_t m_Expected{1};  // the first byte tells the framing
+    bool m_VersionKnown{false};
+    WireVersion m_Version{WireVersion::ASCII};
+    FrameType m_FrameType{FrameType::MESSAGE};
+    uint16_t m_FrameFlags{0};
+
+public:
+    FrameParser();
+
+    // writableSpace - returns the free space after the received bytes, compacting
+    // or growing the buffer so that at least minSize bytes are available
+    // minSize: minimum number of free bytes requested
+    char* writableSpace(size_t minSize = 1);
+
+    // writableSize - number of free bytes after the received bytes
+    size_t writableSize() const;
+
+    // commit - marks bytes written into writableSpace as received
+    // count: number of bytes received
+    void commit(size_t count);
+
+    // append - copies received bytes into the buffer
+    // data: the received bytes
+    // count: number of bytes received
+    void append(const char* data, size_t count);
+
+    // nextFrame - extracts the next complete message
+    // message: output parameter that receives the message payload, valid until the next writableSpace/append call
+    // Returns FRAME when a message was extracted, NEED_MORE when more bytes are needed,
+    // or BAD_HEADER when the header is malformed or the payload too long for the framing
+    Result nextFrame(string_view& message);
+
+    // frameType - type of the last frame returned by nextFrame
+    FrameType frameType() const;
+
+    // frameFlags - flags of the last frame returned by nextFrame
+    uint16_t frameFlags() const;
+
+    // getVersion - framing of the connection, ASCII until the first byte is received
+    WireVersion getVersion() const;
+
+    // getState - current receive state
+    State getState() const;
+};
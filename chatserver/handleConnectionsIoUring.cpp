@@ -0,0 +1,490 @@
+#include <sys/socket.h>
+#include <cerrno>
+#include <optional>
+
+#include "handleConnectionsIoUring.h"
+
+constexpr unsigned URING_ENTRIES = 4096;
+constexpr unsigned URING_BUFFER_COUNT = 4096;
+constexpr size_t URING_BUFFER_SIZE = 4096;
+constexpr uint16_t URING_BUFFER_GROUP = 0;
+constexpr int URING_WAITING_TIME = 500; // ms, lets the loop notice a shutdown
+
+// Request kinds are stored in the low bits of user_data, the connection pointer in the rest.
+// The pointer outlives its requests: a connection is released after its last completion.
+constexpr uint64_t OP_ACCEPT = 0;
+constexpr uint64_t OP_RECV = 1;
+constexpr uint64_t OP_SEND = 2;
+constexpr uint64_t OP_CANCEL = 3;
+constexpr uint64_t OP_MASK = 3;
+
+namespace {
+    uint64_t makeUserData(UringConnection* conn, uint64_t op) {
+        return reinterpret_cast<uint64_t>(conn) | op;
+    }
+}
+
+HandleConnectionsIoUring::HandleConnectionsIoUring(Logger &logger, const string& serverName, const string& portNumber, const ServerConfig& config):
+                        ChatServer(logger, serverName, portNumber, config){
+    m_Logger.log(LogLevel::Info, "{}:HandleConnectionsIoUring class created.", __func__);
+}
+
+HandleConnectionsIoUring::~HandleConnectionsIoUring(){
+    setIsConnected(false);
+    for (auto& [fd, conn] : m_Connections) {
+        close(fd);
+    }
+    m_Logger.log(LogLevel::Debug, "{}:HandleConnectionsIoUring class destroyed.",__func__);
+}
+
+void HandleConnectionsIoUring::acceptConnections(){
+    m_Logger.log(LogLevel::Info, "{}:Accept Connections start", __func__);
+    int ret = m_Ring.init(URING_ENTRIES);
+    if (ret == 0) {
+        ret = m_Ring.registerBufferRing(URING_BUFFER_GROUP, URING_BUFFER_COUNT, URING_BUFFER_SIZE);
+    }
+    if (ret != 0) {
+        m_Logger.log(LogLevel::Error, "{}:io_uring setup failed: {}", __func__, strerror(-ret));
+        setIsConnected(false);
+        return;
+    }
+
+    armAccept();
+    while (getIsConnected()) {
+        // Every SQE queued while handling the previous batch goes out in this one call
+        ret = m_Ring.submitAndWait(1, URING_WAITING_TIME);
+        if (ret < 0) {
+            m_Logger.log(LogLevel::Error, "{}:io_uring_enter failed: {}", __func__, strerror(-ret));
+            break;
+        }
+        m_Ring.forEachCqe([this](const io_uring_cqe& cqe) { handleCompletion(cqe); });
+        closePending();
+        releaseConnections();
+        if (!m_AcceptArmed) {
+            armAccept();
+        }
+    }
+    m_Logger.log(LogLevel::Info, "{}:Stopped accepting connections.", __func__);
+}
+
+void HandleConnectionsIoUring::armAccept(){
+    io_uring_sqe* sqe = m_Ring.getSqe();
+    if (!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = m_SockfdListener;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = makeUserData(nullptr, OP_ACCEPT);
+    m_AcceptArmed = true;
+}
+
+void HandleConnectionsIoUring::armRecv(UringConnection* conn){
+    io_uring_sqe* sqe = m_Ring.getSqe();
+    if (!sqe) {
+        deferClose(conn);
+        return;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->user_data = makeUserData(conn, OP_RECV);
+    conn->recvArmed = true;
+}
+
+void HandleConnectionsIoUring::armSend(UringConnection* conn){
+    const string& frame = *conn->sendQueue.front();
+    io_uring_sqe* sqe = m_Ring.getSqe();
+    if (!sqe) {
+        deferClose(conn);
+        return;
+    }
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = conn->fd;
+    sqe->addr = reinterpret_cast<uint64_t>(frame.data() + conn->sendOffset);
+    sqe->len = static_cast<uint32_t>(frame.size() - conn->sendOffset);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = makeUserData(conn, OP_SEND);
+    conn->sending = true;
+}
+
+void HandleConnectionsIoUring::handleCompletion(const io_uring_cqe& cqe){
+    UringConnection* conn = reinterpret_cast<UringConnection*>(cqe.user_data & ~OP_MASK);
+    switch (cqe.user_data & OP_MASK) {
+        case OP_ACCEPT:
+            if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                m_AcceptArmed = false;
+            }
+            onAccept(cqe.res);
+            break;
+        case OP_RECV:
+            onRecv(conn, cqe);
+            break;
+        case OP_SEND:
+            onSend(conn, cqe.res);
+            break;
+        case OP_CANCEL:
+            break; // the cancelled recv completes with -ECANCELED
+    }
+}
+
+void HandleConnectionsIoUring::onAccept(int clientFd){
+    if (clientFd < 0) {
+        m_Logger.log(LogLevel::Error, "{}:Accept failed: {}", __func__, strerror(-clientFd));
+        return;
+    }
+    m_Logger.log(LogLevel::Info, "{}:Client connected. Socket fd: {}", __func__, clientFd);
+    // One getpeername for the log and the table: a multishot accept shares one
+    // address buffer between its completions, it cannot hand out the peer
+    struct sockaddr_storage sockAddr{};
+    socklen_t sockAddrLen = sizeof(sockAddr);
+    if (getpeername(clientFd, (struct sockaddr *)&sockAddr, &sockAddrLen) == 0) {
+        getClientIP(sockAddr);
+    }
+    if (!addClient(clientFd, &sockAddr)) {
+        close(clientFd);
+        return;
+    }
+    auto conn = make_unique<UringConnection>();
+    conn->fd = clientFd;
+    conn->client = m_Clients.handle(clientFd);
+    UringConnection* raw = conn.get();
+    m_Connections.emplace(clientFd, move(conn));
+    armRecv(raw);
+}
+
+void HandleConnectionsIoUring::onRecv(UringConnection* conn, const io_uring_cqe& cqe){
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+        conn->recvArmed = false;
+    }
+    if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+        uint16_t bufferId = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        bool badHeader = false;
+        bool streamed = false;
+        if (!conn->closing) {
+            conn->parser.append(m_Ring.bufferData(bufferId), cqe.res);
+            string_view message;
+            FrameParser::Result result;
+            while ((result = conn->parser.nextFrame(message)) == FrameParser::FRAME) {
+                if (conn->parser.frameType() == FrameType::CHUNK) {
+                    onChunk(conn, message, conn->parser.frameFlags());
+                    streamed = true;
+                } else {
+                    onMessage(conn, message, conn->parser.frameType());
+                }
+            }
+            badHeader = result == FrameParser::BAD_HEADER;
+        }
+        m_Ring.recycleBuffer(bufferId);
+        if (badHeader) {
+            m_Logger.log(LogLevel::Error, "{}:Invalid message header from socket fd: {}", __func__, conn->fd);
+            closeConnection(conn);
+            return;
+        }
+        if (streamed && !conn->paused &&
+            pauseStream(conn->fd, [this, client = conn->client] { resumeRecv(client); })) {
+            pauseRecv(conn);
+        }
+    }
+    if (cqe.res == -ECANCELED && !conn->closing) {
+        // Paused by a full stream window, or resumed before the cancel landed
+        if (!conn->paused && !conn->recvArmed) {
+            armRecv(conn);
+        }
+        return;
+    }
+    if (cqe.res == 0 || (cqe.res < 0 && cqe.res != -ENOBUFS)) {
+        if (!conn->closing) {
+            m_Logger.log(LogLevel::Info, "{}:Client desconnected", __func__);
+        }
+        closeConnection(conn);
+        return;
+    }
+    if (conn->closing) {
+        closeConnection(conn);
+        return;
+    }
+    if (!conn->recvArmed && !conn->paused) {
+        // The kernel ends a multishot recv when it runs out of buffers
+        armRecv(conn);
+    }
+}
+
+void HandleConnectionsIoUring::onSend(UringConnection* conn, int result){
+    conn->sending = false;
+    if (result < 0 || conn->closing) {
+        closeConnection(conn);
+        return;
+    }
+    conn->sendOffset += result;
+    if (conn->sendOffset == conn->sendQueue.front()->size()) {
+        conn->sendQueue.pop_front();
+        conn->sendOffset = 0;
+    }
+    if (!conn->sendQueue.empty()) {
+        armSend(conn);
+    }
+}
+
+void HandleConnectionsIoUring::onMessage(UringConnection* conn, string_view message, FrameType type){
+    if (Connection* client = m_Clients.find(conn->fd)) {
+        client->messagesReceived.fetch_add(1, memory_order_relaxed);
+        client->bytesReceived.fetch_add(message.length(), memory_order_relaxed);
+    }
+    if (type == FrameType::HELLO) {
+        conn->version = WireVersion::BINARY;
+        queueSend(conn, encodeFrame(string_view{}, WireVersion::BINARY, FrameType::HELLO));
+        return;
+    }
+    if (type != FrameType::MESSAGE) {
+        m_Logger.log(LogLevel::Warning, "{}:Unknown frame type {} from socket fd {}", __func__, static_cast<int>(type), conn->fd);
+        return;
+    }
+    RoomCommand command = parseRoomCommand(message);
+    switch (command.type) {
+        case RoomCommand::JOIN: {
+            lock_guard lock(m_Mutex);
+            m_Rooms.join(command.room, conn->fd);
+            break;
+        }
+        case RoomCommand::LEAVE: {
+            lock_guard lock(m_Mutex);
+            m_Rooms.leave(command.room, conn->fd);
+            break;
+        }
+        case RoomCommand::PUBLISH:
+            publish(conn->fd, command.room, command.text);
+            break;
+        case RoomCommand::INVALID:
+            m_Logger.log(LogLevel::Warning, "{}:Invalid room command from socket fd {}", __func__, conn->fd);
+            break;
+        default:
+            broadcast(conn->fd, message);
+            break;
+    }
+}
+
+shared_ptr<const string> HandleConnectionsIoUring::encodeFrame(string_view message, WireVersion version, FrameType type){
+    shared_ptr<string> frame;
+    if (version == WireVersion::BINARY) {
+        BinaryFrameHeader header = encodeBinaryFrameHeader(message.length(), type);
+        frame = make_shared<string>(header.bytes, BINARY_FRAME_HEADER_SIZE);
+    } else {
+        FrameHeader header = encodeFrameHeader(message.length());
+        frame = make_shared<string>(header.bytes, FRAME_HEADER_SIZE);
+    }
+    frame->append(message);
+    return frame;
+}
+
+void HandleConnectionsIoUring::queueEncoded(UringConnection* conn, EncodedFrames& encoded){
+    if (encoded.message.length() > maxFramePayload(conn->version)) {
+        m_Logger.log(LogLevel::Warning, "{}:Message too long for the framing of socket fd {}", __func__, conn->fd);
+        return;
+    }
+    shared_ptr<const string>& frame = encoded.frames[conn->version == WireVersion::BINARY];
+    if (!frame) {
+        frame = encodeFrame(encoded.message, conn->version);
+    }
+    queueSend(conn, frame);
+}
+
+void HandleConnectionsIoUring::queueSend(UringConnection* conn, const shared_ptr<const string>& frame){
+    conn->sendQueue.push_back(frame);
+    if (!conn->sending) {
+        armSend(conn);
+    }
+}
+
+void HandleConnectionsIoUring::broadcast(int senderFd, string_view message){
+    EncodedFrames encoded{message, {}};
+    for (auto& [fd, conn] : m_Connections) {
+        if (fd != senderFd && !conn->closing) {
+            queueEncoded(conn.get(), encoded);
+        }
+    }
+}
+
+void HandleConnectionsIoUring::publish(int senderFd, string_view room, string_view message){
+    lock_guard lock(m_Mutex);
+    if (!m_Rooms.isMember(room, senderFd)) {
+        m_Logger.log(LogLevel::Warning, "{}:Socket fd {} is not a member of room {}", __func__, senderFd, room);
+        return;
+    }
+    EncodedFrames encoded{message, {}};
+    for (int fd : *m_Rooms.members(room)) {
+        auto it = m_Connections.find(fd);
+        if (fd != senderFd && it != m_Connections.end() && !it->second->closing) {
+            queueEncoded(it->second.get(), encoded);
+        }
+    }
+}
+
+void HandleConnectionsIoUring::onChunk(UringConnection* conn, string_view chunk, uint16_t flags){
+    if (chunk.length() < STREAM_ID_SIZE) {
+        m_Logger.log(LogLevel::Warning, "{}:Invalid chunk from socket fd {}", __func__, conn->fd);
+        return;
+    }
+    string_view data = chunk.substr(STREAM_ID_SIZE);
+    bool last = (flags & FRAME_FLAG_LAST) != 0;
+    lock_guard lock(m_Mutex);
+    auto it = m_Streams.find(conn->fd);
+    if (it == m_Streams.end()) {
+        InboundStream stream{m_NextStreamId++, {}, make_shared<StreamWindow>(m_Config.streamWindowBytes)};
+        RoomCommand command = parseRoomCommand(data);
+        if (command.type == RoomCommand::PUBLISH) {
+            if (!m_Rooms.isMember(command.room, conn->fd)) {
+                m_Logger.log(LogLevel::Warning, "{}:Socket fd {} is not a member of room {}", __func__, conn->fd, command.room);
+            } else {
+                stream.recipients = *m_Rooms.members(command.room);
+            }
+            data = command.text; // the recipients get the text, not the command
+        } else {
+            for (auto& [fd, recipient] : m_Connections) {
+                stream.recipients.push_back(fd);
+            }
+        }
+        it = m_Streams.emplace(conn->fd, move(stream)).first;
+    }
+    queueChunk(it->second, conn->fd, data, last ? FRAME_FLAG_LAST : 0);
+    if (last) {
+        m_Streams.erase(it);
+    }
+}
+
+void HandleConnectionsIoUring::queueChunk(const InboundStream& stream, int senderFd, string_view data, uint16_t flags){
+    // Framed once for every binary recipient, the deleter gives the bytes back to the window
+    BinaryFrameHeader header = encodeBinaryFrameHeader(STREAM_ID_SIZE + data.length(), FrameType::CHUNK, flags);
+    auto bytes = new string(header.bytes, BINARY_FRAME_HEADER_SIZE);
+    bytes->resize(BINARY_FRAME_HEADER_SIZE + STREAM_ID_SIZE);
+    encodeStreamId(stream.id, bytes->data() + BINARY_FRAME_HEADER_SIZE);
+    bytes->append(data);
+    shared_ptr<StreamWindow> window = (flags & FRAME_FLAG_ABORT) ? nullptr : stream.window;
+    if (window) {
+        window->acquire(bytes->size());
+    }
+    shared_ptr<const string> frame(bytes, [window](const string* frame) {
+        if (window) {
+            window->release(frame->size());
+        }
+        delete frame;
+    });
+    for (int fd : stream.recipients) {
+        auto it = m_Connections.find(fd);
+        if (fd != senderFd && it != m_Connections.end() && !it->second->closing &&
+            it->second->version == WireVersion::BINARY) {
+            queueSend(it->second.get(), frame);
+        }
+    }
+}
+
+void HandleConnectionsIoUring::pauseRecv(UringConnection* conn){
+    conn->paused = true;
+    if (!conn->recvArmed) {
+        return; // the multishot recv already ended, it is simply not re-armed
+    }
+    io_uring_sqe* sqe = m_Ring.getSqe();
+    if (!sqe) {
+        conn->paused = false; // keeps reading, the window is exceeded by this connection only
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = makeUserData(conn, OP_RECV);
+    sqe->user_data = makeUserData(conn, OP_CANCEL);
+}
+
+void HandleConnectionsIoUring::resumeRecv(ConnectionHandle client){
+    // Runs on the loop thread, from the send completion that drained the window
+    if (!getIsConnected()) {
+        return;
+    }
+    // The generation tells a later client on the same fd apart, even at the same address
+    auto it = m_Connections.find(client.sd);
+    if (it == m_Connections.end() || it->second->client.generation != client.generation) {
+        return;
+    }
+    UringConnection* conn = it->second.get();
+    if (!conn->paused) {
+        return;
+    }
+    conn->paused = false;
+    if (!conn->recvArmed && !conn->closing) {
+        armRecv(conn);
+    }
+}
+
+void HandleConnectionsIoUring::closeConnection(UringConnection* conn){
+    if (!conn->closing) {
+        conn->closing = true;
+        // Completes the in-flight recv and send so the connection can be released
+        shutdown(conn->fd, SHUT_RDWR);
+        forgetClient(conn->fd);
+    }
+    if (conn->recvArmed || conn->sending || conn->released) {
+        return;
+    }
+    conn->released = true;
+    m_Released.push_back(conn->fd);
+}
+
+void HandleConnectionsIoUring::deferClose(UringConnection* conn){
+    if (conn->closing) {
+        return;
+    }
+    conn->closing = true;
+    shutdown(conn->fd, SHUT_RDWR);
+    m_PendingClose.push_back(conn->fd);
+}
+
+void HandleConnectionsIoUring::closePending(){
+    // forgetClient can defer more closes: the ABORT of a stream may not find an SQE either
+    while (!m_PendingClose.empty()) {
+        int fd = m_PendingClose.back();
+        m_PendingClose.pop_back();
+        forgetClient(fd);
+        auto it = m_Connections.find(fd);
+        if (it != m_Connections.end()) {
+            closeConnection(it->second.get());
+        }
+    }
+}
+
+void HandleConnectionsIoUring::forgetClient(int fd){
+    optional<InboundStream> aborted;
+    {
+        lock_guard lock(m_Mutex);
+        auto it = m_Streams.find(fd);
+        if (it != m_Streams.end()) {
+            aborted = move(it->second);
+            m_Streams.erase(it);
+        }
+        for (auto& [senderFd, stream] : m_Streams) {
+            erase(stream.recipients, fd);
+        }
+        m_Rooms.leaveAll(fd);
+        logClosedClient(fd);
+        m_Clients.remove(fd);
+    }
+    // Queued without m_Mutex, like every send of the closing paths
+    if (aborted) {
+        queueChunk(*aborted, fd, string_view{}, FRAME_FLAG_ABORT);
+    }
+}
+
+void HandleConnectionsIoUring::releaseConnections(){
+    for (int fd : m_Released) {
+        // Taken out of the map first: the frames it frees can resume a stream,
+        // whose callback looks the map up
+        auto it = m_Connections.find(fd);
+        unique_ptr<UringConnection> conn = move(it->second);
+        m_Connections.erase(it);
+        conn.reset();
+        close(fd);
+        m_Logger.log(LogLevel::Debug, "{}:Socket closed.",__func__);
+    }
+    m_Released.clear();
+}
@@ -0,0 +1,162 @@
+#pragma once
+#include <deque>
+#include <memory>
+#include <unordered_map>
+
+#include "chatserver.h"
+#include "frameParser.h"
+#include "ioUring.h"
+#include "../utils/logger.h"
+
+using namespace std;
+
+// UringConnection - state of a client owned by the io_uring loop.
+// It is freed only once no request referencing it is in flight.
+struct UringConnection {
+    int fd{-1};
+    ConnectionHandle client;  // fd and generation, identifies the client in callbacks run later
+    bool closing{false};
+    bool released{false};
+    bool recvArmed{false};
+    bool sending{false};
+    bool paused{false};       // recv cancelled while the window of its stream is full
+    size_t sendOffset{0};
+    deque<shared_ptr<const string>> sendQueue;
+    FrameParser parser;
+    WireVersion version{WireVersion::ASCII}; // framing of the frames sent, BINARY after a HELLO
+};
+
+// EncodedFrames - framed copies of one message, built on first use per framing
+struct EncodedFrames {
+    string_view message;
+    shared_ptr<const string> frames[2];
+};
+
+class HandleConnectionsIoUring: public ChatServer{
+private:
+    IoUring m_Ring;
+    unordered_map<int, unique_ptr<UringConnection>> m_Connections;
+    bool m_AcceptArmed{false};
+    vector<int> m_Released;
+    vector<int> m_PendingClose;   // closed where m_Mutex may be held, finished by closePending
+
+    // armAccept - Queue a multishot accept on the listener
+    void armAccept();
+
+    // armRecv - Queue a multishot recv using the provided buffer ring
+    // conn: the connection to read from
+    void armRecv(UringConnection* conn);
+
+    // armSend - Queue a send of the next pending frame of a connection
+    // conn: the connection to write to
+    void armSend(UringConnection* conn);
+
+    // handleCompletion - Dispatch a completion to the accept, recv or send handler
+    // cqe: the completion queue entry
+    void handleCompletion(const io_uring_cqe& cqe);
+
+    // onAccept - Register a newly accepted client
+    // clientFd: File descriptor for the client connected, or -errno
+    void onAccept(int clientFd);
+
+    // onRecv - Parse the bytes received from a client and fan out every complete frame
+    // conn: the connection the data was read from
+    // cqe: the recv completion
+    void onRecv(UringConnection* conn, const io_uring_cqe& cqe);
+
+    // onSend - Advance the send queue of a connection
+    // conn: the connection written to
+    // result: bytes sent, or -errno
+    void onSend(UringConnection* conn, int result);
+
+    // onMessage - Apply a received message: a HELLO, a room command or plain chat
+    // conn: the connection the message was read from
+    // message: the message payload
+    // type: the frame type
+    void onMessage(UringConnection* conn, string_view message, FrameType type);
+
+    // encodeFrame - Build a framed copy of a message
+    // message: the message payload
+    // version: the framing
+    // type: the frame type, binary framing only
+    shared_ptr<const string> encodeFrame(string_view message, WireVersion version, FrameType type = FrameType::MESSAGE);
+
+    // queueEncoded - Queue a message to a connection in its framing, shared with the
+    // other recipients of the same framing; skipped if the framing cannot carry it
+    // conn: the connection to write to
+    // encoded: the framed copies of the message
+    void queueEncoded(UringConnection* conn, EncodedFrames& encoded);
+
+    // queueSend - Queue a frame to a connection and start sending if it is idle
+    // conn: the connection to write to
+    // frame: the shared frame
+    void queueSend(UringConnection* conn, const shared_ptr<const string>& frame);
+
+    // broadcast - Frame a message once and queue it to every client except the sender
+    // senderFd: File descriptor of the client that sent the message
+    // message: the message payload
+    void broadcast(int senderFd, string_view message);
+
+    // publish - Frame a message once and queue it to the other members of a room
+    // senderFd: File descriptor of the client that sent the message, it must be a member
+    // room: the room name
+    // message: the text of the /pub command, without the command and the room
+    void publish(int senderFd, string_view room, string_view message);
+
+    // onChunk - Forward one chunk of the stream of a connection to the recipients chosen
+    // at its first chunk, then cancel its recv while the stream window is full
+    // conn: the connection streaming
+    // chunk: the CHUNK payload, stream id included
+    // flags: the chunk flags, FRAME_FLAG_LAST ends the stream
+    void onChunk(UringConnection* conn, string_view chunk, uint16_t flags);
+
+    // queueChunk - Queue a CHUNK frame to the binary recipients of a stream. m_Mutex must
+    // be held while the stream is in m_Streams, a stream taken out of it needs no lock.
+    // stream: the stream
+    // senderFd: File descriptor of the client streaming
+    // data: chunk data
+    // flags: chunk flags
+    void queueChunk(const InboundStream& stream, int senderFd, string_view data, uint16_t flags);
+
+    // pauseRecv - Cancel the multishot recv of a connection whose stream window is full
+    // conn: the connection streaming
+    void pauseRecv(UringConnection* conn);
+
+    // resumeRecv - Re-arm the recv of a paused connection once its stream window drained
+    // client: handle of the connection when it was paused, a stale one is ignored
+    void resumeRecv(ConnectionHandle client);
+
+    // closeConnection - Close a client and release it once no request is in flight
+    // conn: the connection to close
+    void closeConnection(UringConnection* conn);
+
+    // deferClose - Mark a connection closing without taking m_Mutex, for the paths that
+    // may already hold it; closePending finishes the close once the batch is handled
+    // conn: the connection to close
+    void deferClose(UringConnection* conn);
+
+    // closePending - Finish the closes deferred while handling the last batch
+    void closePending();
+
+    // forgetClient - Abort the stream of a closed client and drop it from the streams,
+    // the rooms and the client table
+    // fd: File descriptor of the client
+    void forgetClient(int fd);
+
+    // releaseConnections - Free the connections closed while handling the last batch
+    void releaseConnections();
+
+public:
+    // Constructor
+    // logger: reference to Logger instance for logging
+    // serverName: the server hostname or IP address
+    // portNumber: the port number to bind the server socket
+    // config: runtime options for the server
+    HandleConnectionsIoUring(Logger &logger, const string& serverName, const string& portNumber, const ServerConfig& config);
+
+    //Destructor
+    ~HandleConnectionsIoUring();
+
+    // AcceptConnections - Run the io_uring completion loop
+    void acceptConnections() override;
+};
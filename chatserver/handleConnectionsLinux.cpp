@@ -1,5 +1,6 @@
 #include <fcntl.h>
 #include <netinet/in.h>
+#include <algorithm>
 #include <memory>
 
 #include "handleConnectionsLinux.h"
@@ -8,8 +9,47 @@ constexpr int WAITING_TIME = -1;
 constexpr int SUCCESS = 0;
 constexpr int FAILURE = -1;
 
-HandleConnectionsLinux::HandleConnectionsLinux(Logger &logger, const string& serverName, const string& portNumber):
-                        ChatServer(logger, serverName, portNumber){
+ConnectionContexts::ConnectionContexts() : m_Slabs(new atomic<Slot*>[MAX_CONNECTION_SLABS]) {
+    for (size_t i = 0; i < MAX_CONNECTION_SLABS; ++i) {
+        m_Slabs[i].store(nullptr, memory_order_relaxed);
+    }
+}
+
+ConnectionContexts::Slot* ConnectionContexts::slot(int sd, bool allocate) {
+    size_t index = static_cast<size_t>(sd) / CONNECTION_SLAB_SIZE;
+    if (sd < 0 || index >= MAX_CONNECTION_SLABS) {
+        return nullptr;
+    }
+    Slot* slab = m_Slabs[index].load(memory_order_acquire);
+    if (!slab && allocate) {
+        m_Owned.push_back(make_unique<Slot[]>(CONNECTION_SLAB_SIZE));
+        slab = m_Owned.back().get();
+        m_Slabs[index].store(slab, memory_order_release);
+    }
+    return slab ? &slab[static_cast<size_t>(sd) % CONNECTION_SLAB_SIZE] : nullptr;
+}
+
+bool ConnectionContexts::add(int sd) {
+    Slot* context = slot(sd, true);
+    if (!context) {
+        return false;
+    }
+    context->store(make_shared<ConnectionContext>(), memory_order_release);
+    return true;
+}
+
+shared_ptr<ConnectionContext> ConnectionContexts::find(int sd) {
+    Slot* context = slot(sd, false);
+    return context ? context->load(memory_order_acquire) : nullptr;
+}
+
+shared_ptr<ConnectionContext> ConnectionContexts::remove(int sd) {
+    Slot* context = slot(sd, false);
+    return context ? context->exchange(nullptr, memory_order_acq_rel) : nullptr;
+}
+
+HandleConnectionsLinux::HandleConnectionsLinux(Logger &logger, const string& serverName, const string& portNumber, const ServerConfig& config):
+                        ChatServer(logger, serverName, portNumber, config), m_Events(max(1, config.epollBatchSize)){
     m_epollFd = epoll_create1(0);
     struct epoll_event event;
     event.events = EPOLLIN | EPOLLOUT | EPOLLET;
@@ -22,9 +62,16 @@ HandleConnectionsLinux::HandleConnectionsLinux(Logger &logger, const string& ser
 }
 
 HandleConnectionsLinux::~HandleConnectionsLinux(){
-    close(m_SockfdListener);
     setIsConnected(false);
-    m_BroadcastThread.request_stop();
+    close(m_SockfdListener);
+    // Join the workers before the members their tasks use are destroyed:
+    // handleClient and resumeClient read m_Connections, timer and coroutine
+    // tasks reach m_Timers and m_Reactor. Those only feed the pool, so they go after it.
+    threadPool.reset();
+    // Sender threads resume paused clients through m_Connections and m_epollFd
+    stopSenders();
+    m_Timers.reset();
+    m_Reactor.reset();
     m_Logger.log(LogLevel::Debug, "{}:HandleConnectionsLinux class destroyed.",__func__);
     m_Logger.setDone(true);
 }
@@ -33,24 +80,103 @@ void HandleConnectionsLinux::handleClient(int clientFd){
     stringstream threadId;
     threadId << this_thread::get_id();
     m_Logger.log(LogLevel::Debug, "{}:Thread ID: {}", __func__, threadId.str());
-    char buffer[BUFFER_SIZE];
-    int bytesRead = read(clientFd, buffer, sizeof(buffer));
-    if (bytesRead > 0) {
-        lock_guard lock(m_Mutex);
-        for (auto& sd:m_ClientSockets){
-            if (sd != clientFd){
-                buffer[bytesRead] = 0x0;
-                addProadcastMessage(sd, buffer);
-            }    
+    shared_ptr<ConnectionContext> ctx = m_Connections.find(clientFd);
+    if (!ctx) {
+        return;
+    }
+
+    bool closed = false;
+    // Edge-triggered: keep reading until the socket reports EAGAIN
+    while (!closed) {
+        char* space = ctx->parser.writableSpace();
+        ssize_t bytesRead = read(clientFd, space, ctx->parser.writableSize());
+        if (bytesRead > 0) {
+            ctx->parser.commit(bytesRead);
+            string_view message;
+            FrameParser::Result result;
+            bool streamed = false;
+            while ((result = ctx->parser.nextFrame(message)) == FrameParser::FRAME) {
+                handleMessage(clientFd, message, ctx->parser.frameType(), ctx->parser.frameFlags());
+                streamed |= ctx->parser.frameType() == FrameType::CHUNK;
+            }
+            if (result == FrameParser::BAD_HEADER) {
+                m_Logger.log(LogLevel::Error, "{}:Invalid message header from socket fd: {}", __func__, clientFd);
+                closed = true;
+                continue;
+            }
+            if (streamed) {
+                // Stop reading while the stream window is full, the client is
+                // re-armed by the sender thread that drains it. paused is raised
+                // before the window is checked so a resume right after the check
+                // finds it; pauseMutex is not held across pauseStream, which takes
+                // m_Mutex while a sender thread resuming us takes pauseMutex.
+                {
+                    lock_guard pauseLock(ctx->pauseMutex);
+                    ctx->paused = true;
+                }
+                if (pauseStream(clientFd, [this, clientFd, ctx] { resumeClient(clientFd, ctx); })) {
+                    return;
+                }
+                lock_guard pauseLock(ctx->pauseMutex);
+                ctx->paused = false;
+            }
+            continue;
+        }
+        if (bytesRead == 0) {
+            m_Logger.log(LogLevel::Info, "{}:Client desconnected", __func__);
+            closed = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else {
+            m_Logger.log(LogLevel::Error, "{}:Read failed on socket fd: {}", __func__, clientFd);
+            logLastError(m_Logger);
+            closed = true;
         }
     }
-    if (bytesRead == 0){
-        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, clientFd, nullptr);
-        m_Logger.log(LogLevel::Info, "{}:Client desconnected", __func__);
-        closeSocket(clientFd);
+
+    // Messages are queued before re-arming, so the next task of this client
+    // cannot overtake them
+    if (closed || !rearmClient(clientFd)){
+        removeClient(clientFd);
     }   
 }
 
+bool HandleConnectionsLinux::rearmClient(int clientFd){
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLET | EPOLLRDHUP | EPOLLONESHOT;
+    event.data.fd = clientFd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_MOD, clientFd, &event) == FAILURE) {
+        m_Logger.log(LogLevel::Error, "{}:Failed to re-arm socket fd: {}", __func__, clientFd);
+        logLastError(m_Logger);
+        return false;
+    }
+    return true;
+}
+
+void HandleConnectionsLinux::resumeClient(int clientFd, const shared_ptr<ConnectionContext>& ctx){
+    lock_guard pauseLock(ctx->pauseMutex);
+    if (!ctx->paused) {
+        return;
+    }
+    ctx->paused = false;
+    rearmClient(clientFd);
+}
+
+void HandleConnectionsLinux::removeClient(int clientFd){
+    shared_ptr<ConnectionContext> ctx = m_Connections.remove(clientFd);
+    if (!ctx) {
+        return; // already removed by another worker
+    }
+    {
+        lock_guard pauseLock(ctx->pauseMutex);
+        ctx->paused = false;
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, clientFd, nullptr);
+    }
+    closeSocket(clientFd);
+}
+
 int HandleConnectionsLinux::createEpollInstance(){
     m_epollFd = epoll_create1(0);
     if (m_epollFd == -1) {
@@ -72,6 +198,40 @@ int HandleConnectionsLinux::createEpollInstance(){
     size_t threadCount = thread::hardware_concurrency();
     m_Logger.log(LogLevel::Info, "{}:Starting thread poll", __func__);
     threadPool = make_unique<ThreadPool>(threadCount); 
+    // Coroutines are resumed on the pool, the event loop only finds the ready ones
+    m_Reactor = make_unique<CoReactor>([this](coroutine_handle<> handle) {
+        threadPool->enqueue([handle] { handle.resume(); });
+    });
+    int result = m_Reactor->init();
+    event.events = EPOLLIN;
+    event.data.fd = m_Reactor->fd();
+    if (result != SUCCESS || epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_Reactor->fd(), &event) == FAILURE) {
+        m_Logger.log(LogLevel::Error, "{}:Failed to set up the coroutine reactor.", __func__);
+        setIsConnected(false);
+        close(m_epollFd);
+        closeSocket(m_SockfdListener);
+        return FAILURE;
+    }
+    m_Timers = make_unique<TimerScheduler>(*threadPool);
+    result = m_Timers->init();
+    event.events = EPOLLIN;
+    event.data.fd = m_Timers->fd();
+    if (result != SUCCESS || epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_Timers->fd(), &event) == FAILURE) {
+        m_Logger.log(LogLevel::Error, "{}:Failed to set up the timer scheduler.", __func__);
+        setIsConnected(false);
+        close(m_epollFd);
+        closeSocket(m_SockfdListener);
+        return FAILURE;
+    }
+    if (m_Config.poolStatsIntervalMs > 0) {
+        if (!POOL_TELEMETRY_ENABLED) {
+            m_Logger.log(LogLevel::Warning, "{}:--pool-stats needs a build with THREAD_POOL_TELEMETRY, nothing is recorded.", __func__);
+        } else {
+            m_Timers->scheduleEvery(chrono::milliseconds(m_Config.poolStatsIntervalMs), [this] {
+                m_Logger.log(LogLevel::Info, "{}:{}", "poolStats", threadPool->telemetry().format());
+            });
+        }
+    }
     return SUCCESS;
 }
 
@@ -83,27 +243,23 @@ void HandleConnectionsLinux::acceptConnections(){
     }
 
     while (getIsConnected()) {
-        int nfds = epoll_wait(m_epollFd, m_Events, MAX_QUEUE_CONNECTINON, WAITING_TIME);
+        int nfds = epoll_wait(m_epollFd, m_Events.data(), static_cast<int>(m_Events.size()), WAITING_TIME);
         if (nfds == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
             m_Logger.log(LogLevel::Error, "{}:Failed to wait for events.", __func__);
             break;
         }
-        struct epoll_event event;
         int clientFd;
 
         for (int i = 0; i < nfds; ++i) {
             if (m_Events[i].data.fd == m_SockfdListener) {
-                clientFd = accept(m_SockfdListener, NULL, NULL);
-                event.events = EPOLLIN;
-                event.data.fd = clientFd;
-                epoll_ctl(m_epollFd, EPOLL_CTL_ADD, clientFd, &event);
-                m_Logger.log(LogLevel::Info, "{}:Client connected. Socket fd: {}", __func__, clientFd); 
-                makeSocketNonBlocking(clientFd);
-                getClientIP(clientFd);
-                {
-                    lock_guard lock(m_Mutex);   
-                    m_ClientSockets.emplace(clientFd);
-                }
+                acceptClients();
+            } else if (m_Events[i].data.fd == m_Reactor->fd()) {
+                m_Reactor->poll();
+            } else if (m_Events[i].data.fd == m_Timers->fd()) {
+                m_Timers->poll();
             } else {
                 clientFd = m_Events[i].data.fd;
 
@@ -115,6 +271,48 @@ void HandleConnectionsLinux::acceptConnections(){
     m_Logger.log(LogLevel::Info, "{}:Stopped accepting connections.", __func__);
 }
 
+void HandleConnectionsLinux::acceptClients(){
+    // Drain the whole accept queue in one wakeup, a reconnect storm can fill it
+    // faster than one accept per epoll_wait would empty it
+    while (true) {
+        struct sockaddr_storage sockAddr;
+        socklen_t sockAddrLen = sizeof(sockAddr);
+        int clientFd = accept4(m_SockfdListener, (struct sockaddr *)&sockAddr, &sockAddrLen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientFd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                m_Logger.log(LogLevel::Error, "{}:Accept failed.", __func__);
+                logLastError(m_Logger);
+            }
+            return;
+        }
+        m_Logger.log(LogLevel::Info, "{}:Client connected. Socket fd: {}", __func__, clientFd); 
+        getClientIP(sockAddr);
+        if (!addClient(clientFd, &sockAddr)) {
+            close(clientFd);
+            continue;
+        }
+        m_Connections.add(clientFd); // in range, addClient checked it against the same slabs
+        // Registered only once its receive state exists: with EPOLLET
+        // an event handled before that would never be reported again.
+        // EPOLLONESHOT keeps at most one task per client in the pool,
+        // handleClient re-arms it after draining the socket.
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLET | EPOLLRDHUP | EPOLLONESHOT;
+        event.data.fd = clientFd;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, clientFd, &event) == FAILURE) {
+            m_Logger.log(LogLevel::Error, "{}:Failed to add client to epoll.", __func__);
+            removeClient(clientFd);
+        }
+    }
+}
+
+void HandleConnectionsLinux::spawn(CoTask task){
+    threadPool->enqueue([task = move(task)]() mutable { move(task).start(); });
+}
+
 int HandleConnectionsLinux::makeSocketNonBlocking(int sfd) {
     int flags = fcntl(sfd, F_GETFL, 0);
     return fcntl(sfd, F_SETFL, flags | O_NONBLOCK);
@@ -1,32 +1,106 @@
 #pragma once
 #include <sys/epoll.h>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 #include "chatserver.h"
+#include "coReactor.h"
+#include "frameParser.h"
 #include "../utils/logger.h"
 #include "../utils/threadPool.h"
+#include "../utils/timerScheduler.h"
 
 using namespace std;
 
 typedef void *HANDLE;
 typedef unsigned long long SOCKET;
 
+// ConnectionContext - receive state of a client, like ClientContext in the Windows handler.
+// Clients are registered with EPOLLONESHOT, so at most one pool worker owns a
+// context at a time and it needs no lock.
+struct ConnectionContext {
+    FrameParser parser;
+    // Set while reading is paused by a full stream window. The resume callback and
+    // removeClient both take pauseMutex, so a resume never re-arms a removed client.
+    // No other server lock is taken while pauseMutex is held.
+    mutex pauseMutex;
+    bool paused{false};
+};
+
+// ConnectionContexts - the receive state of the clients, indexed by socket descriptor
+// in slabs of CONNECTION_SLAB_SIZE that are never moved, like ConnectionTable. A
+// worker finds the context of an epoll event without a lock or a hash. Only the
+// event loop thread adds; any thread finds and removes.
+class ConnectionContexts {
+private:
+    using Slot = atomic<shared_ptr<ConnectionContext>>;
+    unique_ptr<atomic<Slot*>[]> m_Slabs; // MAX_CONNECTION_SLABS entries, null until used
+    vector<unique_ptr<Slot[]>> m_Owned;  // the allocated slabs, event loop thread only
+
+    // slot - the slot of a descriptor
+    // allocate: allocates its slab if missing, event loop thread only
+    // Returns nullptr if sd is beyond the table or its slab is not allocated
+    Slot* slot(int sd, bool allocate);
+
+public:
+    ConnectionContexts();
+
+    // add - installs a new receive state for sd, event loop thread only
+    // Returns false if sd is beyond the table
+    bool add(int sd);
+
+    // find - the receive state of sd, nullptr if sd has none
+    shared_ptr<ConnectionContext> find(int sd);
+
+    // remove - takes the receive state of sd out of the table
+    // Returns it, nullptr if another thread removed it first
+    shared_ptr<ConnectionContext> remove(int sd);
+};
+
 class HandleConnectionsLinux: public ChatServer{
 private:
     SOCKET m_epollFd;
-    struct epoll_event m_Events[MAX_QUEUE_CONNECTINON];
+    vector<struct epoll_event> m_Events;
+    // threadPool - joined first by the destructor, its tasks use the members below
     unique_ptr<ThreadPool> threadPool;
+    // m_Reactor - resumes coroutines waiting on an fd or a timer, its epoll fd is watched by acceptConnections
+    unique_ptr<CoReactor> m_Reactor;
+    // m_Timers - delayed and periodic pool tasks, its timerfd is watched by acceptConnections
+    unique_ptr<TimerScheduler> m_Timers;
+    // m_Connections - receive state per client socket
+    ConnectionContexts m_Connections;
+
+    // removeClient - Unregister a client from epoll, drop its receive state and close it
+    // clientFd: File descriptor for the client connected
+    void removeClient(int clientFd);
+
+    // acceptClients - Accept every pending connection with accept4 until EAGAIN
+    void acceptClients();
+
+    // rearmClient - Re-enable the oneshot read event of a client once it has been drained
+    // clientFd: File descriptor for the client connected
+    // Returns true if successful, false otherwise
+    bool rearmClient(int clientFd);
+
+    // resumeClient - Re-arm a client paused by a full stream window, called once the window drained
+    // clientFd: File descriptor for the client connected
+    // ctx: receive state of the client when it was paused
+    void resumeClient(int clientFd, const shared_ptr<ConnectionContext>& ctx);
 public:
     // Constructor
     // logger: reference to Logger instance for logging
     // serverName: the server hostname or IP address
     // portNumber: the port number to bind the server socket
-    HandleConnectionsLinux(Logger &logger, const string& serverName, const string& portNumber);
+    // config: runtime options, config.epollBatchSize sizes the epoll_wait batch
+    HandleConnectionsLinux(Logger &logger, const string& serverName, const string& portNumber, const ServerConfig& config = ServerConfig{});
 
     //Destructor
     ~HandleConnectionsLinux();
     
-    // WorkerThread - worker thread function for handling IOCP events
-    // clientDt: File descriptor for the client connected
+    // handleClient - Drain a client socket until EAGAIN, queue every complete frame
+    // for the other clients and re-arm the client
+    // clientFd: File descriptor for the client connected
     void handleClient(int clientFd);
 
     // createEpollInstance - Create epoll instance and setup thread pool
@@ -36,6 +110,18 @@ public:
     // AcceptConnections - Waiting for client connections
     void acceptConnections() override;
 
+    // reactor - Awaitables for coroutines run by spawn: readable(fd), writable(fd) and sleepFor(duration)
+    // Available once createEpollInstance succeeded
+    CoReactor& reactor() { return *m_Reactor; }
+
+    // timers - Delayed and periodic tasks run on the thread pool: scheduleAfter, scheduleEvery and cancel
+    // Available once createEpollInstance succeeded
+    TimerScheduler& timers() { return *m_Timers; }
+
+    // spawn - Start a coroutine on the thread pool, it is resumed on the pool after every co_await of reactor()
+    // task: the coroutine, for example a per-connection handler
+    void spawn(CoTask task);
+
     // makeSocketNonBlocking - Make a socket non-blocking
     // sfd - Socket file descriptor to be made non-blocking
     // Returns 0 on success, -1 on failure
@@ -0,0 +1,230 @@
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <algorithm>
+#include <memory>
+
+#include "handleConnectionsMultiReactor.h"
+
+constexpr int REACTOR_WAITING_TIME = 500; // ms, lets the loop notice a shutdown
+
+HandleConnectionsMultiReactor::HandleConnectionsMultiReactor(Logger &logger, const string& serverName, const string& portNumber, const ServerConfig& config):
+                        ChatServer(logger, serverName, portNumber, config){
+    size_t reactorCount = m_Config.reactorCount;
+    if (reactorCount == 0) {
+        reactorCount = max<size_t>(1, thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < reactorCount; ++i) {
+        m_Reactors.emplace_back(make_unique<Reactor>());
+        m_Reactors.back()->id = i;
+    }
+    m_Logger.log(LogLevel::Info, "{}:HandleConnectionsMultiReactor created with {} reactors", __func__, reactorCount);
+}
+
+HandleConnectionsMultiReactor::~HandleConnectionsMultiReactor(){
+    setIsConnected(false);
+    for (auto& reactor : m_Reactors) {
+        reactor->thread.request_stop();
+        if (reactor->thread.joinable()) {
+            reactor->thread.join();
+        }
+    }
+    // A late resume from a sender thread would act on the epoll fds closed below
+    stopSenders();
+    for (auto& reactor : m_Reactors) {
+        if (reactor->epollFd != -1) {
+            close(reactor->epollFd);
+        }
+        // Reactor 0 shares m_SockfdListener, which the base class closes
+        if (reactor->id != 0 && reactor->listenerFd != -1) {
+            close(reactor->listenerFd);
+        }
+    }
+    m_Logger.log(LogLevel::Debug, "{}:HandleConnectionsMultiReactor class destroyed.",__func__);
+}
+
+bool HandleConnectionsMultiReactor::createReactor(Reactor& reactor){
+    int flags = fcntl(reactor.listenerFd, F_GETFL, 0);
+    fcntl(reactor.listenerFd, F_SETFL, flags | O_NONBLOCK);
+
+    reactor.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (reactor.epollFd == -1) {
+        m_Logger.log(LogLevel::Error, "{}:Reactor {} failed to create epoll file descriptor.", __func__, reactor.id);
+        logLastError(m_Logger);
+        return false;
+    }
+    struct epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = reactor.listenerFd;
+    if (epoll_ctl(reactor.epollFd, EPOLL_CTL_ADD, reactor.listenerFd, &event) == -1) {
+        m_Logger.log(LogLevel::Error, "{}:Reactor {} failed to add listener socket to epoll.", __func__, reactor.id);
+        logLastError(m_Logger);
+        return false;
+    }
+    return true;
+}
+
+void HandleConnectionsMultiReactor::acceptConnections(){
+    m_Logger.log(LogLevel::Info, "{}:Accept Connections start", __func__);
+
+    // createListner already bound m_SockfdListener with SO_REUSEPORT, every other
+    // reactor binds its own listener to the same port
+    m_Reactors[0]->listenerFd = m_SockfdListener;
+    for (size_t i = 1; i < m_Reactors.size(); ++i) {
+        if (!bindListener(true, m_Reactors[i]->listenerFd)) {
+            m_Logger.log(LogLevel::Error, "{}:Reactor {} failed to bind its listener.", __func__, i);
+            setIsConnected(false);
+            return;
+        }
+    }
+    for (auto& reactor : m_Reactors) {
+        if (!createReactor(*reactor)) {
+            setIsConnected(false);
+            return;
+        }
+    }
+
+    for (size_t i = 1; i < m_Reactors.size(); ++i) {
+        Reactor& reactor = *m_Reactors[i];
+        reactor.thread = jthread([this, &reactor](stop_token token) { runReactor(reactor, token); });
+    }
+    runReactor(*m_Reactors[0], stop_token{});
+
+    for (size_t i = 1; i < m_Reactors.size(); ++i) {
+        m_Reactors[i]->thread.request_stop();
+    }
+    m_Logger.log(LogLevel::Info, "{}:Stopped accepting connections.", __func__);
+}
+
+void HandleConnectionsMultiReactor::runReactor(Reactor& reactor, stop_token token){
+    m_Logger.log(LogLevel::Debug, "{}:Reactor {} started.", __func__, reactor.id);
+    vector<struct epoll_event> events(max(1, m_Config.epollBatchSize));
+
+    while (getIsConnected() && !token.stop_requested()) {
+        int nfds = epoll_wait(reactor.epollFd, events.data(), static_cast<int>(events.size()), REACTOR_WAITING_TIME);
+        if (nfds == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            m_Logger.log(LogLevel::Error, "{}:Reactor {} failed to wait for events.", __func__, reactor.id);
+            break;
+        }
+        for (int i = 0; i < nfds; ++i) {
+            if (events[i].data.fd == reactor.listenerFd) {
+                acceptClients(reactor);
+            } else {
+                handleClient(reactor, events[i].data.fd);
+            }
+        }
+    }
+    m_Logger.log(LogLevel::Debug, "{}:Reactor {} stopped.", __func__, reactor.id);
+}
+
+void HandleConnectionsMultiReactor::acceptClients(Reactor& reactor){
+    while (true) {
+        struct sockaddr_storage sockAddr;
+        socklen_t sockAddrLen = sizeof(sockAddr);
+        int clientFd = accept4(reactor.listenerFd, (struct sockaddr *)&sockAddr, &sockAddrLen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientFd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                m_Logger.log(LogLevel::Error, "{}:Reactor {} accept failed.", __func__, reactor.id);
+                logLastError(m_Logger);
+            }
+            return;
+        }
+        if (!addClient(clientFd, &sockAddr)) {
+            close(clientFd);
+            continue;
+        }
+        struct epoll_event event{};
+        event.events = EPOLLIN | EPOLLET | EPOLLRDHUP;
+        event.data.fd = clientFd;
+        if (epoll_ctl(reactor.epollFd, EPOLL_CTL_ADD, clientFd, &event) == -1) {
+            m_Logger.log(LogLevel::Error, "{}:Reactor {} failed to add client to epoll.", __func__, reactor.id);
+            closeSocket(clientFd);
+            continue;
+        }
+        m_Logger.log(LogLevel::Info, "{}:Reactor {} client connected. Socket fd: {}", __func__, reactor.id, clientFd);
+        getClientIP(sockAddr);
+        reactor.clients.try_emplace(clientFd);
+    }
+}
+
+void HandleConnectionsMultiReactor::handleClient(Reactor& reactor, int clientFd){
+    auto it = reactor.clients.find(clientFd);
+    if (it == reactor.clients.end()) {
+        return;
+    }
+    FrameParser& parser = it->second;
+    bool closed = false;
+    while (!closed) {
+        char* space = parser.writableSpace();
+        ssize_t bytesRead = read(clientFd, space, parser.writableSize());
+        if (bytesRead > 0) {
+            parser.commit(bytesRead);
+            string_view message;
+            FrameParser::Result result;
+            bool streamed = false;
+            while ((result = parser.nextFrame(message)) == FrameParser::FRAME) {
+                handleMessage(clientFd, message, parser.frameType(), parser.frameFlags());
+                streamed |= parser.frameType() == FrameType::CHUNK;
+            }
+            if (result == FrameParser::BAD_HEADER) {
+                m_Logger.log(LogLevel::Error, "{}:Reactor {} invalid message header from socket fd: {}", __func__, reactor.id, clientFd);
+                closed = true;
+                continue;
+            }
+            if (streamed && pauseClient(reactor, clientFd)) {
+                return;
+            }
+            continue;
+        }
+        if (bytesRead == 0) {
+            m_Logger.log(LogLevel::Info, "{}:Reactor {} client desconnected", __func__, reactor.id);
+            closed = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else {
+            closed = true;
+        }
+    }
+
+    if (closed) {
+        removeClient(reactor, clientFd);
+    }
+}
+
+bool HandleConnectionsMultiReactor::pauseClient(Reactor& reactor, int clientFd){
+    // Read interest is dropped before the window is checked, so a resume from a
+    // sender thread cannot be overwritten. epoll_ctl re-checks readiness when the
+    // interest comes back, data that arrived meanwhile is reported then.
+    int epollFd = reactor.epollFd;
+    auto setInterest = [epollFd, clientFd](uint32_t events) {
+        struct epoll_event event{};
+        event.events = events | EPOLLET | EPOLLRDHUP;
+        event.data.fd = clientFd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, clientFd, &event);
+    };
+    setInterest(0);
+    // The resume may come after the client closed and its descriptor was reused
+    ConnectionHandle client = m_Clients.handle(clientFd);
+    if (pauseStream(clientFd, [this, setInterest, client] {
+            if (m_Clients.isCurrent(client)) {
+                setInterest(EPOLLIN);
+            }
+        })) {
+        return true;
+    }
+    setInterest(EPOLLIN);
+    return false;
+}
+
+void HandleConnectionsMultiReactor::removeClient(Reactor& reactor, int clientFd){
+    epoll_ctl(reactor.epollFd, EPOLL_CTL_DEL, clientFd, nullptr);
+    reactor.clients.erase(clientFd);
+    closeSocket(clientFd);
+}
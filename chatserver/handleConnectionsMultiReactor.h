@@ -0,0 +1,71 @@
+#pragma once
+#include <sys/epoll.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "chatserver.h"
+#include "frameParser.h"
+#include "../utils/logger.h"
+
+using namespace std;
+
+// Reactor - one event loop: its own SO_REUSEPORT listener, its own epoll
+// instance and the client connections it accepted with their receive state
+struct Reactor {
+    size_t id{0};
+    int listenerFd{-1};
+    int epollFd{-1};
+    unordered_map<int, FrameParser> clients;
+    jthread thread; // declared last so it is joined before the descriptors are closed
+};
+
+class HandleConnectionsMultiReactor: public ChatServer{
+private:
+    vector<unique_ptr<Reactor>> m_Reactors;
+
+    // createReactor - Create the epoll instance of a reactor and register its listener
+    // reactor: the reactor to initialize
+    // Returns true if successful, false otherwise
+    bool createReactor(Reactor& reactor);
+
+    // runReactor - Event loop of a reactor, runs until the server disconnects
+    // reactor: the reactor owning the loop
+    // token: stop token of the reactor thread
+    void runReactor(Reactor& reactor, stop_token token);
+
+    // acceptClients - Accept every pending connection on the reactor listener
+    // reactor: the reactor owning the listener
+    void acceptClients(Reactor& reactor);
+
+    // handleClient - Drain a client socket and queue every complete frame for the other clients
+    // reactor: the reactor owning the client
+    // clientFd: File descriptor for the client connected
+    void handleClient(Reactor& reactor, int clientFd);
+
+    // pauseClient - Stop reading a client while the window of its stream is full,
+    // read interest comes back once the window drained
+    // reactor: the reactor owning the client
+    // clientFd: File descriptor for the client connected
+    // Returns true if the client is paused
+    bool pauseClient(Reactor& reactor, int clientFd);
+
+    // removeClient - Unregister and close a client owned by the reactor
+    // reactor: the reactor owning the client
+    // clientFd: File descriptor for the client connected
+    void removeClient(Reactor& reactor, int clientFd);
+
+public:
+    // Constructor
+    // logger: reference to Logger instance for logging
+    // serverName: the server hostname or IP address
+    // portNumber: the port number to bind the server socket
+    // config: runtime options, config.reactorCount selects the number of reactors
+    HandleConnectionsMultiReactor(Logger &logger, const string& serverName, const string& portNumber, const ServerConfig& config);
+
+    //Destructor
+    ~HandleConnectionsMultiReactor();
+
+    // AcceptConnections - Start the reactors and run the first one on the calling thread
+    void acceptConnections() override;
+};
@@ -31,26 +31,13 @@ void HandleConnectionsWindows::associateSocket(SOCKET clientSocket) {
     if (CreateIoCompletionPort((HANDLE)clientSocket, m_IOCP, (ULONG_PTR)clientSocket, 0) == NULL){
         m_Logger.log(LogLevel::Error, "{}:CreateIoCompletionPort failed:{}", __func__, ERROR_CODE);
         m_Logger.log(LogLevel::Error, "{}:{}", __func__ , getLastErrorDescription());
-        lock_guard lock(m_Mutex);
-        m_ClientSockets.erase(clientSocket);
-        closesocket(clientSocket);
+        closeSocket(clientSocket);
         delete ctx;
         return;
     }
 
-    ctx->state = ClientContext::READ_HEADER;
-    ctx->expected = sizeof(uint32_t);
-    ctx->received = 0;
-    ctx->wsabuf.buf = ctx->buffer;
-    ctx->wsabuf.len = ctx->expected;
-
-    DWORD flags = 0, bytes = 0;
-    auto ret = WSARecv(clientSocket, &ctx->wsabuf, 1, &bytes, &flags, &ctx->overlapped, NULL);
-    if (ret != 0 && ERROR_CODE != WSA_IO_PENDING) {
-        m_Logger.log(LogLevel::Error, "{}:WSARecv failed:{}", __func__, ERROR_CODE);
+    if (!postRecv(clientSocket, ctx)) {
         m_Logger.log(LogLevel::Error, "{}:{}", __func__ , getLastErrorDescription());
-        lock_guard lock(m_Mutex);
-        m_ClientSockets.erase(clientSocket);
         closeSocket(clientSocket);
         delete ctx;
     }
@@ -70,8 +57,6 @@ void HandleConnectionsWindows::workerThread(HANDLE iocp) {
         ClientContext* ctx = reinterpret_cast<ClientContext*>(lpOverlapped);
         if (!result || bytesTransferred == 0) {
             closeSocket(completionKey);
-            lock_guard lock(m_Mutex);
-            m_ClientSockets.erase(completionKey);
             m_Logger.log(LogLevel::Debug, "{}:Client disconnected.",__func__);    
             delete ctx;
             continue;
@@ -112,84 +97,53 @@ void HandleConnectionsWindows::workerThread(HANDLE iocp) {
         handleCompletion(ctx, bytesTransferred, (SOCKET)completionKey);
     }
 }
-void HandleConnectionsWindows::repostRecv(SOCKET sd, ClientContext* ctx) {
-    m_Logger.log(LogLevel::Debug, "{}:Reposting receive...", __func__);
+bool HandleConnectionsWindows::postRecv(SOCKET sd, ClientContext* ctx) {
+    m_Logger.log(LogLevel::Debug, "{}:Posting receive...", __func__);
 
-    ctx->wsabuf.buf = ctx->buffer + ctx->received;
-    ctx->wsabuf.len = ctx->expected - ctx->received;
-
-    DWORD flags = 0, bytes = 0;
-    int rc = WSARecv(sd, &ctx->wsabuf, 1, &bytes, &flags, &ctx->overlapped, NULL);
-    if (rc == SOCKET_ERROR && ERROR_CODE != WSA_IO_PENDING) {
-        m_Logger.log(LogLevel::Error, "{}:WSARecv failed: {}", __func__, ERROR_CODE);
-    }
-}
-
-void HandleConnectionsWindows::postReadHeader(SOCKET sd, ClientContext* ctx) {
-    m_Logger.log(LogLevel::Debug, "{}:Posting read for header...", __func__);
-
-    ctx->state = ClientContext::READ_HEADER;
-    ctx->expected = sizeof(uint32_t);
-    ctx->received = 0;
-    ctx->wsabuf.buf = ctx->buffer;
-    ctx->wsabuf.len = ctx->expected;
+    ZeroMemory(&ctx->overlapped, sizeof(OVERLAPPED));
+    ctx->wsabuf.buf = ctx->parser.writableSpace();
+    ctx->wsabuf.len = static_cast<ULONG>(ctx->parser.writableSize());
 
     DWORD flags = 0, bytes = 0;
     int rc = WSARecv(sd, &ctx->wsabuf, 1, &bytes, &flags, &ctx->overlapped, NULL);
     if (rc == SOCKET_ERROR && ERROR_CODE != WSA_IO_PENDING) {
         m_Logger.log(LogLevel::Error, "{}:WSARecv failed: {}", __func__, ERROR_CODE);
+        return false;
     }
+    return true;
 }
 
 void HandleConnectionsWindows::handleCompletion(ClientContext* ctx, DWORD bytesTransferred, SOCKET sd) {
     m_Logger.log(LogLevel::Debug, "{}:Handling completion, bytes transferred: {}", __func__, bytesTransferred);
 
-    ctx->received += bytesTransferred;
-
-    if (ctx->state == ClientContext::READ_HEADER) {
-        if (ctx->received < ctx->expected) {
-            repostRecv(sd, ctx);
-            return;
-        }
-
-        uint32_t msgLen;
-        msgLen = atoi(ctx->buffer);
-
-        ctx->state = ClientContext::READ_BODY;
-        ctx->expected = msgLen;
-        ctx->received = 0;
-        ctx->wsabuf.buf = ctx->buffer;
-        ctx->wsabuf.len = msgLen;
-
-        ZeroMemory(&ctx->overlapped, sizeof(OVERLAPPED));
-        DWORD flags = 0, bytes = 0;
-        auto errorCode = WSARecv(sd, &ctx->wsabuf, 1, &bytes, &flags, &ctx->overlapped, NULL);
-        if (errorCode == SOCKET_ERROR) {
-            int wserr = WSAGetLastError();
-            if (wserr != WSA_IO_PENDING) {
-                lock_guard lock(m_Mutex);
-                m_ClientSockets.erase(sd);
-                closesocket(sd);
-                logLastError(m_Logger, wserr);
-            }
-        }
+    // The parser decodes the header with the helpers shared with the client,
+    // every complete frame of this receive is handled at once
+    ctx->parser.commit(bytesTransferred);
+    string_view message;
+    FrameParser::Result result;
+    bool streamed = false;
+    while ((result = ctx->parser.nextFrame(message)) == FrameParser::FRAME) {
+        handleMessage(sd, message, ctx->parser.frameType(), ctx->parser.frameFlags());
+        streamed |= ctx->parser.frameType() == FrameType::CHUNK;
     }
-    else if (ctx->state == ClientContext::READ_BODY) {
-        if (ctx->received < ctx->expected) {
-            repostRecv(sd, ctx);
-            return;
-        }
-
-        string message(ctx->buffer, ctx->expected);
-        lock_guard lock(m_Mutex);
-        for (auto& _sd:m_ClientSockets){
-            if (_sd != sd){
-                addProadcastMessage(_sd, message);
-            }    
+    if (result == FrameParser::BAD_HEADER) {
+        m_Logger.log(LogLevel::Error, "{}:Invalid message header from socket: {}", __func__, sd);
+        closeSocket(sd);
+        delete ctx;
+        return;
+    }
+    auto resume = [this, sd, ctx] {
+        if (!postRecv(sd, ctx)) {
+            closeSocket(sd);
+            delete ctx;
         }
-
-        postReadHeader(sd, ctx); // loop back to next message
+    };
+    // No receive is posted while the stream window is full, the broadcast
+    // thread posts it once the window drained
+    if (streamed && pauseStream(sd, resume)) {
+        return;
     }
+    resume();
 }
 
 void HandleConnectionsWindows::acceptConnections() {
@@ -205,14 +159,9 @@ void HandleConnectionsWindows::acceptConnections() {
         }
 
         m_Logger.log(LogLevel::Debug, "{}:Client connected successfully.",__func__);
-        pair<unordered_set<int>::iterator, bool> result;
-        {
-            lock_guard lock(m_Mutex);
-            result = m_ClientSockets.emplace(clientSocket);
-        }
-        if (!result.second)
+        if (!addClient(static_cast<int>(clientSocket)))
         {
-            m_Logger.log(LogLevel::Error, "{}:Failed to add client socket to the set.",__func__);
+            m_Logger.log(LogLevel::Error, "{}:Failed to add client socket to the connection table.",__func__);
             m_Logger.log(LogLevel::Error, "{}:{}", __func__ , getLastErrorDescription());
             closesocket(clientSocket);
             continue;
@@ -6,6 +6,7 @@
 
 
 #include "chatserver.h"
+#include "frameParser.h"
 #include "../utils/logger.h"
 #include "../utils/util.h"
 
@@ -13,16 +14,10 @@ using namespace std;
 struct ClientContext {
     OVERLAPPED overlapped;
     WSABUF wsabuf{};
-    enum State { READ_HEADER, READ_BODY } state = READ_HEADER;
-    size_t expected = 0;
-    size_t received = 0;
-    static constexpr int BUFFER_SZ = 2048;
-    char buffer[BUFFER_SZ + 1];
+    FrameParser parser; // ASCII or binary frames, the first byte tells
 
     ClientContext() {
         ZeroMemory(&overlapped, sizeof(OVERLAPPED));
-        wsabuf.buf = buffer;
-        wsabuf.len = sizeof(buffer);
     }
 };
 
@@ -36,13 +31,10 @@ private:
     // sd: Socket descriptor of the client  
     void handleCompletion(ClientContext* ctx, DWORD bytesTransferred, SOCKET sd);
     
-    // postReadHeader - Post a read operation for the message header
-    // sd: Socket descriptor of the client  
-    void postReadHeader(SOCKET sd, ClientContext* ctx);
-
-    // repostRecv - Repost a receive operation for the client
-    // sd: Socket descriptor of the client  
-    void repostRecv(SOCKET sd, ClientContext* ctx);
+    // postRecv - Post a receive into the free space of the client frame parser
+    // sd: Socket descriptor of the client
+    // Returns false if the receive could not be posted
+    bool postRecv(SOCKET sd, ClientContext* ctx);
     
     // workerThread - worker thread function for handling IOCP events
     // iocp: the IO completion port handle
@@ -0,0 +1,220 @@
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+#include "ioUring.h"
+
+namespace {
+    int ioUringSetup(unsigned entries, io_uring_params* params) {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, void* arg, size_t argSize) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+    }
+
+    int ioUringRegister(int fd, unsigned opcode, void* arg, unsigned nrArgs) {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs));
+    }
+}
+
+IoUring::~IoUring() {
+    if (m_BufMemory) {
+        munmap(m_BufMemory, m_BufMemorySize);
+    }
+    if (m_BufRing) {
+        munmap(m_BufRing, m_BufRingSize);
+    }
+    if (m_Sqes) {
+        munmap(m_Sqes, m_SqesSize);
+    }
+    if (m_CqRing && m_CqRing != m_SqRing) {
+        munmap(m_CqRing, m_CqRingSize);
+    }
+    if (m_SqRing) {
+        munmap(m_SqRing, m_SqRingSize);
+    }
+    if (m_RingFd != -1) {
+        close(m_RingFd);
+    }
+}
+
+int IoUring::init(unsigned entries) {
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 4; // multishot requests post many completions per SQE
+    m_RingFd = ioUringSetup(entries, &params);
+    if (m_RingFd < 0) {
+        m_RingFd = -1;
+        return -errno;
+    }
+    if (!(params.features & IORING_FEAT_EXT_ARG)) {
+        return -EOPNOTSUPP;
+    }
+    m_SqEntries = params.sq_entries;
+    m_CqEntries = params.cq_entries;
+
+    m_SqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        m_SqRingSize = m_CqRingSize = max(m_SqRingSize, m_CqRingSize);
+    }
+    m_SqRing = mmap(nullptr, m_SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_RingFd, IORING_OFF_SQ_RING);
+    if (m_SqRing == MAP_FAILED) {
+        m_SqRing = nullptr;
+        return -errno;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        m_CqRing = m_SqRing;
+    } else {
+        m_CqRing = mmap(nullptr, m_CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_RingFd, IORING_OFF_CQ_RING);
+        if (m_CqRing == MAP_FAILED) {
+            m_CqRing = nullptr;
+            return -errno;
+        }
+    }
+    m_SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    m_Sqes = static_cast<io_uring_sqe*>(mmap(nullptr, m_SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_RingFd, IORING_OFF_SQES));
+    if (m_Sqes == MAP_FAILED) {
+        m_Sqes = nullptr;
+        return -errno;
+    }
+
+    char* sq = static_cast<char*>(m_SqRing);
+    m_SqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    m_SqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    m_SqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    // SQE slots map one to one to the submission array, it never changes after setup
+    unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < m_SqEntries; ++i) {
+        array[i] = i;
+    }
+    m_SqeTail = m_SqeSubmitted = *m_SqTail;
+
+    char* cq = static_cast<char*>(m_CqRing);
+    m_CqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    m_CqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    m_CqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    m_Cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return 0;
+}
+
+int IoUring::registerBufferRing(uint16_t group, unsigned count, size_t bufferSize) {
+    m_BufEntries = count;
+    m_BufMask = count - 1;
+    m_BufSize = bufferSize;
+    m_BufRingSize = count * sizeof(io_uring_buf);
+    void* ring = mmap(nullptr, m_BufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) {
+        return -errno;
+    }
+    m_BufRing = static_cast<io_uring_buf*>(ring);
+    // The ring tail overlays the resv field of the first entry
+    m_BufRingTail = &m_BufRing[0].resv;
+    m_BufMemorySize = count * bufferSize;
+    void* memory = mmap(nullptr, m_BufMemorySize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return -errno;
+    }
+    m_BufMemory = static_cast<char*>(memory);
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(m_BufRing);
+    reg.ring_entries = count;
+    reg.bgid = group;
+    if (ioUringRegister(m_RingFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        return -errno;
+    }
+    for (unsigned i = 0; i < count; ++i) {
+        io_uring_buf& buf = m_BufRing[(m_BufTail + i) & m_BufMask];
+        buf.addr = reinterpret_cast<uint64_t>(m_BufMemory + i * bufferSize);
+        buf.len = static_cast<uint32_t>(bufferSize);
+        buf.bid = static_cast<uint16_t>(i);
+    }
+    m_BufTail = static_cast<uint16_t>(m_BufTail + count);
+    __atomic_store_n(m_BufRingTail, m_BufTail, __ATOMIC_RELEASE);
+    return 0;
+}
+
+io_uring_sqe* IoUring::getSqe() {
+    unsigned head = __atomic_load_n(m_SqHead, __ATOMIC_ACQUIRE);
+    if (m_SqeTail - head >= m_SqEntries) {
+        if (submitAndWait(0, 0) < 0) {
+            return nullptr;
+        }
+        head = __atomic_load_n(m_SqHead, __ATOMIC_ACQUIRE);
+        if (m_SqeTail - head >= m_SqEntries) {
+            return nullptr;
+        }
+    }
+    io_uring_sqe* sqe = &m_Sqes[m_SqeTail & m_SqMask];
+    memset(sqe, 0, sizeof(*sqe));
+    ++m_SqeTail;
+    return sqe;
+}
+
+int IoUring::submitAndWait(unsigned minComplete, int timeoutMs) {
+    unsigned toSubmit = m_SqeTail - m_SqeSubmitted;
+    __atomic_store_n(m_SqTail, m_SqeTail, __ATOMIC_RELEASE);
+    m_SqeSubmitted = m_SqeTail;
+
+    unsigned flags = 0;
+    __kernel_timespec ts{};
+    io_uring_getevents_arg arg{};
+    if (minComplete > 0) {
+        flags |= IORING_ENTER_GETEVENTS;
+        if (timeoutMs >= 0) {
+            ts.tv_sec = timeoutMs / 1000;
+            ts.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+        }
+        flags |= IORING_ENTER_EXT_ARG;
+    }
+    if (toSubmit == 0 && minComplete == 0) {
+        return 0;
+    }
+    int ret = ioUringEnter(m_RingFd, toSubmit, minComplete, flags,
+                           (flags & IORING_ENTER_EXT_ARG) ? &arg : nullptr,
+                           (flags & IORING_ENTER_EXT_ARG) ? sizeof(arg) : 0);
+    if (ret < 0) {
+        if (errno == ETIME || errno == EINTR) {
+            return 0;
+        }
+        return -errno;
+    }
+    return ret;
+}
+
+char* IoUring::bufferData(uint16_t bufferId) const {
+    return m_BufMemory + static_cast<size_t>(bufferId) * m_BufSize;
+}
+
+void IoUring::recycleBuffer(uint16_t bufferId) {
+    io_uring_buf& buf = m_BufRing[m_BufTail & m_BufMask];
+    buf.addr = reinterpret_cast<uint64_t>(bufferData(bufferId));
+    buf.len = static_cast<uint32_t>(m_BufSize);
+    buf.bid = bufferId;
+    ++m_BufTail;
+    __atomic_store_n(m_BufRingTail, m_BufTail, __ATOMIC_RELEASE);
+}
+
+bool IoUring::isSupported() {
+    IoUring probe;
+    if (probe.init(8) != 0) {
+        return false;
+    }
+    if (probe.registerBufferRing(0, 8, 64) != 0) {
+        return false;
+    }
+    // Multishot recv landed in the same release as IORING_OP_SEND_ZC
+    alignas(io_uring_probe) char storage[sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op)]{};
+    io_uring_probe* ops = reinterpret_cast<io_uring_probe*>(storage);
+    if (ioUringRegister(probe.m_RingFd, IORING_REGISTER_PROBE, ops, IORING_OP_LAST) < 0) {
+        return false;
+    }
+    return ops->last_op >= IORING_OP_SEND_ZC &&
+           (ops->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED);
+}
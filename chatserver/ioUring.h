@@ -0,0 +1,111 @@
+#pragma once
+#include <linux/io_uring.h>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// IoUring - minimal io_uring wrapper built on the raw system calls.
+// SQEs are batched: getSqe only reserves a slot, submitAndWait publishes every
+// reserved SQE to the kernel with a single io_uring_enter call.
+class IoUring {
+private:
+    int m_RingFd{-1};
+    unsigned m_SqEntries{0};
+    unsigned m_CqEntries{0};
+
+    // Submission queue
+    void* m_SqRing{nullptr};
+    size_t m_SqRingSize{0};
+    unsigned* m_SqHead{nullptr};
+    unsigned* m_SqTail{nullptr};
+    unsigned m_SqMask{0};
+    io_uring_sqe* m_Sqes{nullptr};
+    size_t m_SqesSize{0};
+    unsigned m_SqeTail{0};      // local tail, published on submit
+    unsigned m_SqeSubmitted{0}; // last tail published to the kernel
+
+    // Completion queue
+    void* m_CqRing{nullptr};
+    size_t m_CqRingSize{0};
+    unsigned* m_CqHead{nullptr};
+    unsigned* m_CqTail{nullptr};
+    unsigned m_CqMask{0};
+    io_uring_cqe* m_Cqes{nullptr};
+
+    // Provided buffer ring. Accessed as a plain io_uring_buf array: in C++ the
+    // flexible bufs member of io_uring_buf_ring does not start at offset 0.
+    io_uring_buf* m_BufRing{nullptr};
+    uint16_t* m_BufRingTail{nullptr};
+    size_t m_BufRingSize{0};
+    unsigned m_BufEntries{0};
+    unsigned m_BufMask{0};
+    uint16_t m_BufTail{0};
+    char* m_BufMemory{nullptr};
+    size_t m_BufMemorySize{0};
+    size_t m_BufSize{0};
+
+public:
+    IoUring() = default;
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Destructor - unmaps the rings and closes the ring descriptor
+    ~IoUring();
+
+    // init - creates the ring
+    // entries: number of submission queue entries (power of two)
+    // Returns 0 on success, -errno on failure
+    int init(unsigned entries);
+
+    // registerBufferRing - registers a provided buffer ring used by IOSQE_BUFFER_SELECT
+    // group: buffer group id
+    // count: number of buffers (power of two)
+    // bufferSize: size in bytes of every buffer
+    // Returns 0 on success, -errno on failure
+    int registerBufferRing(uint16_t group, unsigned count, size_t bufferSize);
+
+    // getSqe - reserves a submission queue entry, flushing the queue when it is full
+    // Returns a zeroed SQE, or nullptr if the queue cannot be flushed
+    io_uring_sqe* getSqe();
+
+    // submitAndWait - submits every reserved SQE and waits for completions
+    // minComplete: number of completions to wait for
+    // timeoutMs: maximum wait time in milliseconds, -1 waits forever
+    // Returns the number of SQEs submitted, or -errno on failure
+    int submitAndWait(unsigned minComplete, int timeoutMs);
+
+    // forEachCqe - calls handler for every available completion and consumes them
+    // handler: callable receiving a const io_uring_cqe&
+    // Returns the number of completions handled
+    template<typename Handler>
+    unsigned forEachCqe(Handler&& handler) {
+        unsigned head = *m_CqHead;
+        unsigned tail = __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        while (head != tail) {
+            handler(m_Cqes[head & m_CqMask]);
+            ++head;
+            ++count;
+            if (head == tail) {
+                // New completions may have been posted while handling this batch
+                __atomic_store_n(m_CqHead, head, __ATOMIC_RELEASE);
+                tail = __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE);
+            }
+        }
+        __atomic_store_n(m_CqHead, head, __ATOMIC_RELEASE);
+        return count;
+    }
+
+    // bufferData - address of a provided buffer
+    // bufferId: id reported in the CQE flags
+    char* bufferData(uint16_t bufferId) const;
+
+    // recycleBuffer - gives a provided buffer back to the kernel
+    // bufferId: id reported in the CQE flags
+    void recycleBuffer(uint16_t bufferId);
+
+    // isSupported - probes the running kernel for the features used by the io_uring backend
+    // (provided buffer rings, multishot accept/recv and extended enter arguments)
+    static bool isSupported();
+};
@@ -1,7 +1,9 @@
 #include <iostream>
 #include <thread>
+#include <vector>
 #include "chatserver.h"
 #include "startserver.h"
+#include "serverConfig.h"
 #include "../utils/outputStream.h"
 
 constexpr int PORT = 8080;
@@ -11,13 +13,119 @@ void usage(const char* _argv, const string& serverName, const string& logFileNam
     cout << "  server_name: The hostname or IP address to bind the server (default: " << serverName << ")\n";
     cout << "  port_number: The port number to bind the server (default: " << PORT << ")\n";
     cout << "  log_file_name: The name of the log file to be create (default: " << logFileName << ")\n";
+    cout << "Options:\n";
+    cout << "  --reactor[=N]: run N reactor threads, each with its own SO_REUSEPORT listener (default N: hardware concurrency)\n";
+    cout << "  --uring: drive accept, recv and send through io_uring (falls back to epoll when unsupported)\n";
+    cout << "  --backlog=N: listen backlog, capped by net.core.somaxconn (default: " << DEFAULT_LISTEN_BACKLOG << ")\n";
+    cout << "  --epoll-batch=N: maximum events returned by one epoll_wait (default: " << DEFAULT_EPOLL_BATCH_SIZE << ")\n";
+    cout << "  --batch=N: frames written to a client per sendmsg (default: " << DEFAULT_BATCH_MAX_FRAMES << ")\n";
+    cout << "  --batch-latency-us=N: wait up to N microseconds for a burst to fill a batch (default: 0, write at once)\n";
+    cout << "  --senders=N: broadcast sender threads, each owning a shard of the clients (default N: hardware concurrency)\n";
+    cout << "  --ring=N: slots of each sender ring, rounded up to a power of two (default: " << DEFAULT_RING_CAPACITY << ")\n";
+    cout << "  --ring-wait=spin|yield|block: how handlers wait while a sender ring is full (default: yield)\n";
+    cout << "  --stream-window=N: bytes of a streamed message in flight before its sender is paused (default: " << DEFAULT_STREAM_WINDOW << ")\n";
+    cout << "  --pool-stats=N: log thread pool telemetry every N milliseconds, needs a THREAD_POOL_TELEMETRY build (default: off)\n";
 }
 
-int main (int argc, const char* argv[]){
+// parsePositive - parses the value of a --option=N argument
+// arg: the command line argument
+// prefix: the option name including the '='
+// value: output parameter that receives the parsed value
+// Returns false if arg does not start with prefix or the value is not a positive integer
+bool parsePositive(const string& arg, const string& prefix, int& value){
+    if (arg.rfind(prefix, 0) != 0) {
+        return false;
+    }
+    try {
+        value = stoi(arg.substr(prefix.length()));
+        return value > 0;
+    } catch (const std::exception& e) {
+        return false;
+    }
+}
+
+// parseOption - applies a --option argument to the server configuration
+// arg: the command line argument
+// config: the configuration to update
+// Returns false if the option is unknown or invalid
+bool parseOption(const string& arg, ServerConfig& config){
+    if (arg == "--uring") {
+        config.backend = ServerBackend::IO_URING;
+        return true;
+    }
+    if (arg == "--reactor") {
+        config.backend = ServerBackend::MULTI_REACTOR;
+        return true;
+    }
+    int value = 0;
+    if (parsePositive(arg, "--reactor=", value)) {
+        config.backend = ServerBackend::MULTI_REACTOR;
+        config.reactorCount = value;
+        return true;
+    }
+    if (parsePositive(arg, "--backlog=", value)) {
+        config.listenBacklog = value;
+        return true;
+    }
+    if (parsePositive(arg, "--epoll-batch=", value)) {
+        config.epollBatchSize = value;
+        return true;
+    }
+    if (parsePositive(arg, "--batch=", value)) {
+        config.batchMaxFrames = value;
+        return true;
+    }
+    if (parsePositive(arg, "--batch-latency-us=", value)) {
+        config.batchMaxLatencyUs = value;
+        return true;
+    }
+    if (parsePositive(arg, "--stream-window=", value)) {
+        config.streamWindowBytes = value;
+        return true;
+    }
+    if (parsePositive(arg, "--pool-stats=", value)) {
+        config.poolStatsIntervalMs = value;
+        return true;
+    }
+    if (parsePositive(arg, "--ring=", value)) {
+        config.ringCapacity = value;
+        return true;
+    }
+    if (arg == "--ring-wait=spin" || arg == "--ring-wait=yield" || arg == "--ring-wait=block") {
+        string mode = arg.substr(arg.find('=') + 1);
+        config.ringWait = mode == "spin" ? WaitStrategy::SPIN : mode == "yield" ? WaitStrategy::YIELD : WaitStrategy::BLOCK;
+        return true;
+    }
+    if (parsePositive(arg, "--senders=", value)) {
+        config.senderCount = value;
+        return true;
+    }
+    return false;
+}
+
+int main (int _argc, const char* _argv[]){
     
     string serverName = "localhost";
     string portNumber{to_string(PORT)};
     string logFileName{"chatServer.log"};
+    ServerConfig config;
+
+    // Options may appear anywhere, the remaining arguments are positional
+    vector<const char*> args{_argv[0]};
+    for (int i = 1; i < _argc; ++i) {
+        string arg(_argv[i]);
+        if (arg.rfind("--", 0) == 0 && arg != "--help") {
+            if (!parseOption(arg, config)) {
+                cout << "Invalid option: " << arg << "\n";
+                usage(_argv[0], serverName, logFileName);
+                return 0;
+            }
+            continue;
+        }
+        args.push_back(_argv[i]);
+    }
+    int argc = static_cast<int>(args.size());
+    const char** argv = args.data();
 
     if (argc > 1 && (string(argv[1]) == "-h" || string(argv[1]) == "--help")) {
         usage(argv[0], serverName, logFileName);
@@ -59,7 +167,7 @@ int main (int argc, const char* argv[]){
         cout << "Log file name not provided, Using default log file name: " << logFileName << "\n";
     }
     
-    StartServer startServer(logFileName, serverName, portNumber);
+    StartServer startServer(logFileName, serverName, portNumber, config);
     startServer.Run();
 
     return 0;
@@ -0,0 +1,113 @@
+#include <algorithm>
+
+#include "roomRegistry.h"
+
+constexpr string_view JOIN_COMMAND{"/join "};
+constexpr string_view LEAVE_COMMAND{"/leave "};
+constexpr string_view PUBLISH_COMMAND{"/pub "};
+
+static bool validRoomName(string_view room) {
+    return !room.empty() && room.size() <= MAX_ROOM_NAME && room.find(' ') == string_view::npos;
+}
+
+RoomCommand parseRoomCommand(string_view message) {
+    RoomCommand command;
+    if (message.empty() || message[0] != '/') {
+        return command;
+    }
+    if (message.starts_with(JOIN_COMMAND)) {
+        command.type = RoomCommand::JOIN;
+        command.room = message.substr(JOIN_COMMAND.size());
+    } else if (message.starts_with(LEAVE_COMMAND)) {
+        command.type = RoomCommand::LEAVE;
+        command.room = message.substr(LEAVE_COMMAND.size());
+    } else if (message.starts_with(PUBLISH_COMMAND)) {
+        command.type = RoomCommand::PUBLISH;
+        string_view rest = message.substr(PUBLISH_COMMAND.size());
+        size_t space = rest.find(' ');
+        command.room = rest.substr(0, space);
+        command.text = space == string_view::npos ? string_view{} : rest.substr(space + 1);
+    } else {
+        return command;
+    }
+    if (!validRoomName(command.room)) {
+        command.type = RoomCommand::INVALID;
+    }
+    return command;
+}
+
+bool RoomRegistry::join(string_view room, int sd) {
+    auto it = m_Rooms.find(room);
+    if (it == m_Rooms.end()) {
+        it = m_Rooms.emplace(string(room), vector<int>{}).first;
+    }
+    vector<int>& members = it->second;
+    auto position = lower_bound(members.begin(), members.end(), sd);
+    if (position != members.end() && *position == sd) {
+        return false;
+    }
+    members.insert(position, sd);
+    m_ClientRooms[sd].emplace_back(room);
+    return true;
+}
+
+bool RoomRegistry::leave(string_view room, int sd) {
+    auto it = m_Rooms.find(room);
+    if (it == m_Rooms.end()) {
+        return false;
+    }
+    vector<int>& members = it->second;
+    auto position = lower_bound(members.begin(), members.end(), sd);
+    if (position == members.end() || *position != sd) {
+        return false;
+    }
+    members.erase(position);
+    if (members.empty()) {
+        m_Rooms.erase(it);
+    }
+    auto client = m_ClientRooms.find(sd);
+    if (client != m_ClientRooms.end()) {
+        vector<string>& rooms = client->second;
+        rooms.erase(find(rooms.begin(), rooms.end(), room));
+        if (rooms.empty()) {
+            m_ClientRooms.erase(client);
+        }
+    }
+    return true;
+}
+
+void RoomRegistry::leaveAll(int sd) {
+    auto client = m_ClientRooms.find(sd);
+    if (client == m_ClientRooms.end()) {
+        return;
+    }
+    for (const auto& room : client->second) {
+        auto it = m_Rooms.find(room);
+        if (it == m_Rooms.end()) {
+            continue;
+        }
+        vector<int>& members = it->second;
+        auto position = lower_bound(members.begin(), members.end(), sd);
+        if (position != members.end() && *position == sd) {
+            members.erase(position);
+        }
+        if (members.empty()) {
+            m_Rooms.erase(it);
+        }
+    }
+    m_ClientRooms.erase(client);
+}
+
+bool RoomRegistry::isMember(string_view room, int sd) const {
+    const vector<int>* roomMembers = members(room);
+    return roomMembers && binary_search(roomMembers->begin(), roomMembers->end(), sd);
+}
+
+const vector<int>* RoomRegistry::members(string_view room) const {
+    auto it = m_Rooms.find(room);
+    return it == m_Rooms.end() ? nullptr : &it->second;
+}
+
+size_t RoomRegistry::roomCount() const {
+    return m_Rooms.size();
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+constexpr size_t MAX_ROOM_NAME{64};
+
+// RoomCommand - a chat message decoded as a room operation:
+//   /join <room>           add the sender to a room
+//   /leave <room>          remove the sender from a room
+//   /pub <room> <text>     deliver <text> to the other members of a room
+// Any other message is plain chat and is delivered to every client.
+struct RoomCommand {
+    enum Type { NONE, JOIN, LEAVE, PUBLISH, INVALID };
+    Type type{NONE};
+    string_view room;
+    string_view text;   // what a PUBLISH delivers, empty for the other commands
+};
+
+// parseRoomCommand - decodes the room operation of a message
+// message: the message payload
+// Returns a command of type NONE for plain chat, INVALID for a malformed command
+RoomCommand parseRoomCommand(string_view message);
+
+// RoomRegistry - room membership. Every room keeps its members as a sorted
+// vector of socket descriptors, so delivering to a room costs one pass over its
+// members however many clients are connected. Not thread safe, the owner guards it.
+class RoomRegistry {
+private:
+    // RoomNameHash - lets the maps be searched with a string_view without building a string
+    struct RoomNameHash {
+        using is_transparent = void;
+        size_t operator()(string_view name) const { return hash<string_view>{}(name); }
+    };
+
+    unordered_map<string, vector<int>, RoomNameHash, equal_to<>> m_Rooms;
+    unordered_map<int, vector<string>> m_ClientRooms; // rooms joined by every client
+
+public:
+    // join - adds a client to a room, creating the room on first use
+    // room: the room name
+    // sd: the socket descriptor of the client
+    // Returns false if the client already was a member
+    bool join(string_view room, int sd);
+
+    // leave - removes a client from a room, dropping the room once it is empty
+    // room: the room name
+    // sd: the socket descriptor of the client
+    // Returns false if the client was not a member
+    bool leave(string_view room, int sd);
+
+    // leaveAll - removes a disconnected client from every room it joined
+    // sd: the socket descriptor of the client
+    void leaveAll(int sd);
+
+    // isMember - checks the membership of a client
+    // room: the room name
+    // sd: the socket descriptor of the client
+    bool isMember(string_view room, int sd) const;
+
+    // members - sorted members of a room
+    // room: the room name
+    // Returns nullptr if the room does not exist, valid until the registry changes
+    const vector<int>* members(string_view room) const;
+
+    // roomCount - number of rooms with at least one member
+    size_t roomCount() const;
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <thread>
+#include "../utils/sequencedRing.h"
+
+using namespace std;
+
+constexpr int DEFAULT_LISTEN_BACKLOG{4096};
+constexpr int DEFAULT_EPOLL_BATCH_SIZE{1024};
+constexpr size_t DEFAULT_BATCH_MAX_FRAMES{64};
+constexpr size_t DEFAULT_RING_CAPACITY{16384};
+constexpr size_t DEFAULT_STREAM_WINDOW{1024 * 1024};
+
+// ServerBackend - selects the connection handler created by chatServerFactory
+enum class ServerBackend {
+    EPOLL,          // single epoll loop dispatching reads to a thread pool
+    MULTI_REACTOR,  // one SO_REUSEPORT listener and epoll loop per reactor thread
+    IO_URING        // accept, recv and send driven by io_uring, falls back to EPOLL when unsupported
+};
+
+// ServerConfig - runtime options passed from the command line to the server
+struct ServerConfig {
+    ServerBackend backend{ServerBackend::EPOLL};
+    // reactorCount - number of reactor threads in MULTI_REACTOR mode (0 = hardware_concurrency())
+    size_t reactorCount{0};
+    // listenBacklog - listen() backlog, the kernel caps it at net.core.somaxconn
+    int listenBacklog{DEFAULT_LISTEN_BACKLOG};
+    // epollBatchSize - maximum number of events returned by one epoll_wait
+    int epollBatchSize{DEFAULT_EPOLL_BATCH_SIZE};
+    // senderCount - number of broadcast sender threads, clients are sharded by fd (0 = hardware_concurrency())
+    size_t senderCount{0};
+    // batchMaxFrames - frames written to one client per sendmsg; a coalescing wait ends early once
+    // this many frames are pending
+    size_t batchMaxFrames{DEFAULT_BATCH_MAX_FRAMES};
+    // batchMaxLatencyUs - how long a sender waits for a burst to fill a batch (0 = write at once)
+    int batchMaxLatencyUs{0};
+    // ringCapacity - slots of the per-sender ring between handlers and a sender, rounded up to a power of two
+    size_t ringCapacity{DEFAULT_RING_CAPACITY};
+    // ringWait - how a handler waits for a slot while a sender ring is full
+    WaitStrategy::Mode ringWait{WaitStrategy::YIELD};
+    // streamWindowBytes - chunk bytes of one streamed message queued to its recipients before
+    // the server stops reading from the sender
+    size_t streamWindowBytes{DEFAULT_STREAM_WINDOW};
+    // poolStatsIntervalMs - how often the epoll backend logs its thread pool telemetry (0 = never),
+    // recorded only in builds with THREAD_POOL_TELEMETRY
+    int poolStatsIntervalMs{0};
+};
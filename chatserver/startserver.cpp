@@ -1,9 +1,9 @@
 #include "startserver.h"
 #include "chatServerFactory.h"
 
-StartServer::StartServer(const string& logFileName, const string& serverName, const string& portNumber)
+StartServer::StartServer(const string& logFileName, const string& serverName, const string& portNumber, const ServerConfig& config)
     : m_Logger(LoggerFactory::getInstance(logFileName)),
-      m_chatServer(chatServerFactory::getInstance(m_Logger, serverName, portNumber))
+      m_chatServer(chatServerFactory::getInstance(m_Logger, serverName, portNumber, config))
 {
 }
 
@@ -3,6 +3,7 @@
 #include <thread>
 #include <mutex>
 #include "chatserver.h"
+#include "serverConfig.h"
 #include "../utils/logger.h"
 
 using namespace std;
@@ -14,6 +15,6 @@ private:
     Logger& m_Logger;
     unique_ptr<ChatServer> m_chatServer;
 public:
-    StartServer(const string& logFileName, const string& serverName, const string& portNumber);
+    StartServer(const string& logFileName, const string& serverName, const string& portNumber, const ServerConfig& config = ServerConfig{});
     int Run();
 };
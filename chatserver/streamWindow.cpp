@@ -0,0 +1,32 @@
+#include "streamWindow.h"
+
+StreamWindow::StreamWindow(size_t limit) : m_Limit(limit) {
+}
+
+void StreamWindow::acquire(size_t bytes) {
+    m_InFlight.fetch_add(bytes, memory_order_relaxed);
+}
+
+void StreamWindow::release(size_t bytes) {
+    if (m_InFlight.fetch_sub(bytes, memory_order_acq_rel) - bytes >= m_Limit) {
+        return;
+    }
+    function<void()> resume;
+    {
+        lock_guard lock(m_Mutex);
+        swap(resume, m_Resume);
+    }
+    if (resume) {
+        resume();
+    }
+}
+
+bool StreamWindow::pause(function<void()> resume) {
+    // Checked under the lock: a release after the check finds resume and calls it
+    lock_guard lock(m_Mutex);
+    if (m_InFlight.load(memory_order_acquire) < m_Limit) {
+        return false;
+    }
+    m_Resume = move(resume);
+    return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+
+using namespace std;
+
+// StreamWindow - flow control of one streamed message. It counts the chunk bytes
+// queued to the recipients and not written yet; the connection of the sender stops
+// reading while they exceed the window and resumes once they drained below it.
+// Memory per message in flight stays bounded by the window plus one receive buffer.
+class StreamWindow {
+private:
+    atomic<size_t> m_InFlight{0};
+    size_t m_Limit;
+    mutex m_Mutex;             // guards m_Resume
+    function<void()> m_Resume; // set while the sender is paused
+
+public:
+    // Constructor
+    // limit: bytes in flight above which the sender is paused
+    explicit StreamWindow(size_t limit);
+
+    // acquire - accounts a chunk queued to the recipients
+    // bytes: chunk size
+    void acquire(size_t bytes);
+
+    // release - accounts a chunk written to, or dropped by, every recipient and
+    // resumes the sender when the window has drained
+    // bytes: chunk size
+    void release(size_t bytes);
+
+    // pause - pauses the sender if the window is full
+    // resume: called once, from the thread releasing the window, when the sender may read again
+    // Returns false if the window has room, resume is not kept
+    bool pause(function<void()> resume);
+};
@@ -4,6 +4,7 @@
 #include <thread>
 #include <cerrno>
 #include <chrono>
+#include <algorithm>
 
 #ifdef _WIN32
     #include <winsock2.h>
@@ -14,13 +15,13 @@
     #include <arpa/inet.h>
     #include <netdb.h>
     #include <sys/socket.h>
+    #include <sys/uio.h>
 #endif
 
 #include "clientSocket.h"
 #include "../utils/util.h"
+#include "../utils/wireFrame.h"
 
-constexpr int BUFFER_SIZE{2048};
-constexpr int MESSAGE_SIZE_HEADER{4};
 
 ClientSocket::ClientSocket(Logger& logger, const string& ip, const char* portHostName) : 
         m_Logger(logger), m_ip(ip), m_PortHostName(portHostName) {
@@ -74,68 +75,96 @@ int ClientSocket::connect()
         }
     }
     m_Logger.log(LogLevel::Info, "{}:Connected", __func__);
+    // Binary frames from the first byte on; the server answers with a HELLO and
+    // switches the frames it sends, an ASCII-only server closes the connection
+    m_WireVersion = WireVersion::BINARY;
+    if (sendFrame(string_view{}, FrameType::HELLO) < 0) {
+        return -1;
+    }
     m_chatActive.store(true); // Mark chat as active
     return 0;
 }
 
-int ClientSocket::readSize(){
-    char buffer[MESSAGE_SIZE_HEADER + 1];
-    memset(buffer, 0, sizeof(buffer));
-    int bytes_received = recv(m_sockfd, buffer, sizeof(buffer) - 1, 0);
-    if (bytes_received == ULLONG_MAX || bytes_received == 0)
+bool ClientSocket::receiveAll(char* data, size_t size){
+    size_t total_bytes_read = 0;
+    while (total_bytes_read < size)
     {
-        m_Logger.log(LogLevel::Info, "{}:Clonnection closed.",__func__);
-        cout << __func__ << ":Server closed the connection." << "\n";
+        int bytes_received = recv(m_sockfd, data + total_bytes_read, static_cast<int>(size - total_bytes_read), 0);
+        if (bytes_received <= 0)
+        {
+            m_Logger.log(LogLevel::Info, "{}:Clonnection closed.",__func__);
+            cout << __func__ << ":Server closed the connection." << "\n";
+            return false;
+        }
+        total_bytes_read += bytes_received;
+    }
+    return true;
+}
+
+bool ClientSocket::readHeader(FrameInfo& info){
+    // Frames queued before the server saw the HELLO are still ASCII
+    char buffer[BINARY_FRAME_HEADER_SIZE];
+    if (!receiveAll(buffer, 1)) {
+        return false;
+    }
+    WireVersion version = wireVersionOf(buffer[0]);
+    if (!receiveAll(buffer + 1, frameHeaderSize(version) - 1)) {
+        return false;
+    }
+    info = FrameInfo{};
+    bool valid = version == WireVersion::BINARY ? decodeBinaryFrameHeader(buffer, info)
+                                                : decodeFrameHeader(buffer, info.length);
+    if (!valid) {
+        m_Logger.log(LogLevel::Error, "{}:Invalid message header from server.",__func__);
+    }
+    return valid;
+}
+
+int ClientSocket::readSize(){
+    FrameInfo info;
+    if (!readHeader(info)) {
         return -1;
     }
-    return stoi(string(buffer));
+    return static_cast<int>(info.length);
 }
 
 int ClientSocket::readMessage(string &message){
-    char buffer[BUFFER_SIZE + 1];
-    memset(buffer, 0, sizeof(buffer));
-    int bytes_to_read = readSize();
-    int total_bytes_read = 0;
-    if (bytes_to_read == -1){
-        m_Logger.log(LogLevel::Info, "{}:Failed to read message size.",__func__);
-        return -1;
-    }   
-    while(total_bytes_read < bytes_to_read){
-        int bytes_received = recv(m_sockfd, buffer + total_bytes_read, bytes_to_read - total_bytes_read, 0);
-        if (bytes_received == ULLONG_MAX || bytes_received == 0)
-        {
-            m_Logger.log(LogLevel::Info, "{}:Clonnection closed.",__func__);
-            cout << __func__ << ":Server closed the connection." << "\n";
+    FrameInfo info;
+    do {
+        if (!readHeader(info)) {
+            m_Logger.log(LogLevel::Info, "{}:Failed to read message size.",__func__);
             return -1;
         }
-        total_bytes_read += bytes_received;
+        message.resize(info.length);
+        if (!receiveAll(message.data(), info.length)) {
+            return -1;
+        }
+        if (info.type == FrameType::HELLO) {
+            m_Logger.log(LogLevel::Debug, "{}:Server accepted binary frames.",__func__);
+        }
+    } while (info.type == FrameType::HELLO || (info.type == FrameType::CHUNK && info.length < STREAM_ID_SIZE));
+    if (info.type == FrameType::CHUNK) {
+        uint32_t streamId = decodeStreamId(message.data());
+        message.erase(0, STREAM_ID_SIZE);
+        m_Logger.log(LogLevel::Debug, "{}:Chunk of stream {}:{} bytes{}",__func__, streamId, message.size(),
+                     (info.flags & FRAME_FLAG_ABORT) ? ", aborted" : (info.flags & FRAME_FLAG_LAST) ? ", last" : "");
+        return static_cast<int>(message.size());
     }
-    if (total_bytes_read > 0)
-    {
-        buffer[total_bytes_read] = '\0'; 
-        m_Logger.log(LogLevel::Debug, "{}:Message size:{}",__func__, total_bytes_read + MESSAGE_SIZE_HEADER);
-        //m_Logger.log(LogLevel::Debug, "{}:Received from server:{}",__func__, buffer);
-        //cout << __func__ << ":Message size received: " << total_bytes_read + MESSAGE_SIZE_HEADER << "\n";
-        //cout << __func__ << ":Message received: " << buffer << "\n";
-        message = string(buffer);
-        return total_bytes_read;
-    }
-    else if (strcmp(buffer, "quit") == 0)
+    m_Logger.log(LogLevel::Debug, "{}:Message size:{}",__func__, info.length + frameHeaderSize(m_WireVersion));
+    if (message == "quit")
     {
         m_Logger.log(LogLevel::Debug, "{}:Quit command received, closing connection.",__func__);
     }
-    else
-    {
-        m_Logger.log(LogLevel::Error, "{}:Error receiving data from server.",__func__);
-    }
-    return -1; // Indicate error or connection closed
+    return static_cast<int>(info.length);
 }
 
 int ClientSocket::sendMessage(int messageSize)
 {
-    string length_str = to_string(messageSize);
-    string padded_length_str = string(4 - length_str.length(), '0') + length_str;
-    int bytes_sent = send(m_sockfd, padded_length_str.c_str(), padded_length_str.size(), 0);
+    BinaryFrameHeader binaryHeader = encodeBinaryFrameHeader(messageSize);
+    FrameHeader header = encodeFrameHeader(messageSize);
+    bool binary = m_WireVersion == WireVersion::BINARY;
+    int bytes_sent = send(m_sockfd, binary ? binaryHeader.bytes : header.bytes,
+                          static_cast<int>(frameHeaderSize(m_WireVersion)), 0);
     if (bytes_sent < 0)
     {
         m_Logger.log(LogLevel::Error,"{}:Error sending data to server.",__func__);
@@ -148,21 +177,73 @@ int ClientSocket::sendMessage(int messageSize)
     return bytes_sent;   
 }
 
-int ClientSocket::sendMessage(const string& message)
+int ClientSocket::sendFrame(string_view payload, FrameType type, uint16_t flags)
 {
-    int bytes_sent = sendMessage(message.size());
-    if (bytes_sent < 0)
+    if (payload.size() > maxFramePayload(m_WireVersion))
     {
+        m_Logger.log(LogLevel::Error,"{}:Message too long:{}",__func__, payload.size());
         return -1;
     }
-    
-    bytes_sent = send(m_sockfd, message.c_str(), message.size(), 0);
+    // Header and body are gathered into a single call
+    BinaryFrameHeader binaryHeader = encodeBinaryFrameHeader(payload.size(), type, flags);
+    FrameHeader header = encodeFrameHeader(payload.size());
+    char* headerBytes = m_WireVersion == WireVersion::BINARY ? binaryHeader.bytes : header.bytes;
+    size_t headerSize = frameHeaderSize(m_WireVersion);
+#ifdef _WIN32
+    WSABUF buffers[2];
+    buffers[0].buf = headerBytes;
+    buffers[0].len = static_cast<ULONG>(headerSize);
+    buffers[1].buf = const_cast<char*>(payload.data());
+    buffers[1].len = static_cast<ULONG>(payload.size());
+    DWORD sent = 0;
+    int bytes_sent = WSASend(m_sockfd, buffers, 2, &sent, 0, nullptr, nullptr) == SOCKET_ERROR ? -1 : static_cast<int>(sent);
+#else
+    struct iovec iov[2];
+    iov[0].iov_base = headerBytes;
+    iov[0].iov_len = headerSize;
+    iov[1].iov_base = const_cast<char*>(payload.data());
+    iov[1].iov_len = payload.size();
+    struct msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    int bytes_sent = sendmsg(m_sockfd, &msg, MSG_NOSIGNAL);
+#endif
     if (bytes_sent < 0)
     {
         m_Logger.log(LogLevel::Error,"{}:Error sending data to server.",__func__);
         logLastError(m_Logger);
         return -1;
     }
+    return bytes_sent - static_cast<int>(headerSize);
+}
+
+int ClientSocket::sendStream(string_view message)
+{
+    uint32_t streamId = m_NextStreamId++;
+    string chunk(STREAM_ID_SIZE, '\0');
+    encodeStreamId(streamId, chunk.data());
+    size_t offset = 0;
+    do {
+        size_t length = min(STREAM_CHUNK_SIZE, message.size() - offset);
+        chunk.resize(STREAM_ID_SIZE);
+        chunk.append(message.substr(offset, length));
+        offset += length;
+        uint16_t flags = offset == message.size() ? FRAME_FLAG_LAST : 0;
+        if (sendFrame(chunk, FrameType::CHUNK, flags) < 0) {
+            return -1;
+        }
+    } while (offset < message.size());
+    return static_cast<int>(message.size());
+}
+
+int ClientSocket::sendMessage(const string& message)
+{
+    bool stream = m_WireVersion == WireVersion::BINARY && message.size() > STREAM_CHUNK_SIZE;
+    int bytes_sent = stream ? sendStream(message) : sendFrame(message, FrameType::MESSAGE);
+    if (bytes_sent < 0)
+    {
+        return -1;
+    }
     cout << __func__ << ": Message size sent: " << bytes_sent << "\n";  
     m_Logger.log(LogLevel::Debug, "{}:Message size:{}",__func__, bytes_sent);
     //m_Logger.log(LogLevel::Debug, "{}:Sent to server:{}",__func__, message);
@@ -14,6 +14,7 @@
     #include <netinet/in.h>
 #endif
 #include "../utils/logger.h"
+#include "../utils/wireFrame.h"
 
 using namespace std;
 
@@ -27,11 +28,36 @@ private:
     //threadSafeQueue<string> m_IncomingQueue;
     jthread m_ReaderThread;
     Logger& m_Logger;    
+    WireVersion m_WireVersion{WireVersion::ASCII}; // framing of the frames sent, BINARY once the HELLO is sent
+    uint32_t m_NextStreamId{1};
+
+    // receiveAll - reads exactly size bytes
+    // data: destination buffer
+    // size: number of bytes to read
+    // returns false if the connection was closed or failed
+    bool receiveAll(char* data, size_t size);
+
+    // readHeader - reads the header of the next frame, ASCII or binary as told by its first byte
+    // info: output parameter that receives the decoded header
+    // returns false on error/disconnection or a malformed header
+    bool readHeader(FrameInfo& info);
+
+    // sendFrame - sends a header and payload in the current framing
+    // payload: the frame payload
+    // type: the frame type, binary framing only
+    // returns number of payload bytes sent, or -1 on error
+    int sendFrame(string_view payload, FrameType type, uint16_t flags = 0);
+
+    // sendStream - sends a message as CHUNK frames of STREAM_CHUNK_SIZE data bytes,
+    // the server forwards each one as it arrives
+    // message: the message to send
+    // returns number of bytes of message sent, or -1 on error
+    int sendStream(string_view message);
 public:
     // Constructor
     ClientSocket(Logger& logger, const string& ip, const char* m_portHostName);
     
-    //connect - establish connection to server
+    //connect - establish connection to server and negotiate binary frames
     int connect();
     
     //SocketClosed - close the socket connection
@@ -48,16 +74,18 @@ public:
     ClientSocket(ClientSocket&&) = delete;
     ClientSocket& operator=(ClientSocket&&) = delete;  
     
-    // sendMessage - send a single message to server
+    // sendMessage - send a single message to server, streamed in chunks when it is
+    // longer than STREAM_CHUNK_SIZE
     // message - the message to send
     // returns number of bytes sent, or -1 on error
     int sendMessage(const string& message);
 
-    // sendMessage - send message size to server
+    // sendMessage - send message size to server, as a header in the current framing
     // messageSize - size of the message to send
     int sendMessage(int messageSize);
 
-    // readMessage - read a single message from server
+    // readMessage - read a single message from server. A streamed message is
+    // returned one chunk at a time, as the chunks arrive
     // message - is output parameter to hold the received message
     // returns number of bytes read, or -1 on error/disconnection
     int readMessage(string &message);
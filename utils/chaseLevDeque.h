@@ -0,0 +1,113 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// ChaseLevDeque - work-stealing deque of Chase and Lev, with the memory orders of
+// Le, Pop, Cohen and Zappa Nardelli (PPoPP 2013). The owner thread pushes and takes
+// at the bottom without any read-modify-write except for the last element; thieves
+// steal from the top with one compare and swap. The array grows when it is full,
+// replaced arrays are kept until the deque is destroyed because a thief may still
+// read from one. T must be trivially copyable, usually a pointer.
+template<typename T>
+class ChaseLevDeque {
+private:
+    struct Array {
+        int64_t capacity;
+        int64_t mask;
+        unique_ptr<atomic<T>[]> cells;
+
+        explicit Array(int64_t size) : capacity(size), mask(size - 1), cells(new atomic<T>[size]) {}
+
+        T get(int64_t index) const { return cells[index & mask].load(memory_order_relaxed); }
+        void put(int64_t index, T value) { cells[index & mask].store(value, memory_order_relaxed); }
+    };
+
+    alignas(64) atomic<int64_t> m_Top{0};    // next index stolen
+    alignas(64) atomic<int64_t> m_Bottom{0}; // next index pushed by the owner
+    atomic<Array*> m_Array;
+    vector<unique_ptr<Array>> m_Arrays;      // current and replaced arrays, owner only
+
+    // grow - doubles the array, copying the live range [top, bottom)
+    Array* grow(Array* array, int64_t top, int64_t bottom) {
+        auto bigger = make_unique<Array>(array->capacity * 2);
+        for (int64_t i = top; i < bottom; ++i) {
+            bigger->put(i, array->get(i));
+        }
+        Array* raw = bigger.get();
+        m_Arrays.push_back(move(bigger));
+        m_Array.store(raw, memory_order_release);
+        return raw;
+    }
+
+public:
+    // Constructor
+    // capacity: initial number of cells, a power of two
+    explicit ChaseLevDeque(int64_t capacity = 256) {
+        m_Arrays.push_back(make_unique<Array>(capacity));
+        m_Array.store(m_Arrays.back().get(), memory_order_relaxed);
+    }
+
+    ChaseLevDeque(const ChaseLevDeque&) = delete;
+    ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+    // push - adds a value at the bottom, owner thread only
+    void push(T value) {
+        int64_t bottom = m_Bottom.load(memory_order_relaxed);
+        int64_t top = m_Top.load(memory_order_acquire);
+        Array* array = m_Array.load(memory_order_relaxed);
+        if (bottom - top > array->capacity - 1) {
+            array = grow(array, top, bottom);
+        }
+        array->put(bottom, value);
+        atomic_thread_fence(memory_order_release);
+        m_Bottom.store(bottom + 1, memory_order_relaxed);
+    }
+
+    // take - removes the value at the bottom, owner thread only
+    // value: output parameter that receives the value
+    // Returns false if the deque is empty
+    bool take(T& value) {
+        int64_t bottom = m_Bottom.load(memory_order_relaxed) - 1;
+        Array* array = m_Array.load(memory_order_relaxed);
+        m_Bottom.store(bottom, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        int64_t top = m_Top.load(memory_order_relaxed);
+        if (top > bottom) {
+            m_Bottom.store(bottom + 1, memory_order_relaxed);
+            return false;
+        }
+        value = array->get(bottom);
+        if (top == bottom) {
+            // Last element: race the thieves for it
+            bool won = m_Top.compare_exchange_strong(top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+            m_Bottom.store(bottom + 1, memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // steal - removes the value at the top, any thread
+    // value: output parameter that receives the value
+    // Returns false if the deque is empty or another thread won the value
+    bool steal(T& value) {
+        int64_t top = m_Top.load(memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        int64_t bottom = m_Bottom.load(memory_order_acquire);
+        if (top >= bottom) {
+            return false;
+        }
+        Array* array = m_Array.load(memory_order_acquire);
+        value = array->get(top);
+        return m_Top.compare_exchange_strong(top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+    }
+
+    // empty - whether the deque looked empty, approximate while other threads run
+    bool empty() const {
+        return m_Bottom.load(memory_order_relaxed) <= m_Top.load(memory_order_relaxed);
+    }
+};
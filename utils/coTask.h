@@ -0,0 +1,101 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+using namespace std;
+
+// CoTask - coroutine returning nothing, for connection logic written as straight
+// line code that suspends on co_await instead of holding a thread. A CoTask starts
+// suspended. It runs either when another coroutine co_awaits it, which resumes
+// the awaiting coroutine when it finishes, or when start() detaches it; a detached
+// task frees its frame when it finishes. An exception escaping a detached task
+// terminates the process, like one escaping a thread; an awaited task rethrows it
+// in the awaiting coroutine.
+class CoTask {
+public:
+    struct promise_type {
+        coroutine_handle<> continuation;
+        exception_ptr error;
+        bool detached{false};
+
+        CoTask get_return_object() { return CoTask(coroutine_handle<promise_type>::from_promise(*this)); }
+
+        suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+
+            coroutine_handle<> await_suspend(coroutine_handle<promise_type> handle) noexcept {
+                promise_type& promise = handle.promise();
+                if (promise.continuation) {
+                    return promise.continuation;
+                }
+                if (promise.detached) {
+                    handle.destroy();
+                }
+                return noop_coroutine();
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void return_void() {}
+
+        void unhandled_exception() {
+            if (detached) {
+                terminate();
+            }
+            error = current_exception();
+        }
+    };
+
+    CoTask(CoTask&& other) noexcept : m_Handle(exchange(other.m_Handle, {})) {}
+
+    CoTask& operator=(CoTask&& other) noexcept {
+        if (this != &other) {
+            if (m_Handle) {
+                m_Handle.destroy();
+            }
+            m_Handle = exchange(other.m_Handle, {});
+        }
+        return *this;
+    }
+
+    CoTask(const CoTask&) = delete;
+    CoTask& operator=(const CoTask&) = delete;
+
+    ~CoTask() {
+        if (m_Handle) {
+            m_Handle.destroy();
+        }
+    }
+
+    // start - detaches the task and runs it on the calling thread until its first suspension
+    void start() && {
+        coroutine_handle<promise_type> handle = exchange(m_Handle, {});
+        handle.promise().detached = true;
+        handle.resume();
+    }
+
+    // co_await - runs the task, the awaiting coroutine continues once it finished
+    bool await_ready() const noexcept { return !m_Handle || m_Handle.done(); }
+
+    coroutine_handle<> await_suspend(coroutine_handle<> awaiting) noexcept {
+        m_Handle.promise().continuation = awaiting;
+        return m_Handle;
+    }
+
+    void await_resume() {
+        if (m_Handle && m_Handle.promise().error) {
+            rethrow_exception(m_Handle.promise().error);
+        }
+    }
+
+private:
+    explicit CoTask(coroutine_handle<promise_type> handle) : m_Handle(handle) {}
+
+    coroutine_handle<promise_type> m_Handle;
+};
@@ -0,0 +1,115 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+constexpr size_t EPOCH_READER_SLOTS{16}; // reader counters, spread over cache lines
+
+// EpochDomain - epoch based reclamation for data published through an atomic
+// pointer and read without a lock. Readers enter the current epoch with a Guard,
+// which never waits. Writers swap the pointer and retire the old object, which is
+// freed once every reader that could still see it has left: the epoch only moves
+// from E to E + 1 when no reader is left in E - 1, so an object retired in epoch
+// E is unreachable once the epoch reached E + 2.
+// Readers count themselves per epoch parity, in one of EPOCH_READER_SLOTS slots
+// chosen per thread, so concurrent readers seldom share a cache line.
+// retire and reclaim are not thread safe, the writers serialize them.
+class EpochDomain {
+private:
+    struct alignas(64) ReaderSlot {
+        atomic<uint64_t> active[2]{};
+    };
+
+    struct Retired {
+        uint64_t epoch;
+        const void* object;
+        void (*destroy)(const void*);
+    };
+
+    ReaderSlot m_Slots[EPOCH_READER_SLOTS];
+    atomic<uint64_t> m_Epoch{0};
+    vector<Retired> m_Retired;
+
+    // slotIndex - the reader slot of the calling thread, assigned round robin on first use
+    static size_t slotIndex() {
+        static atomic<size_t> nextSlot{0};
+        thread_local size_t index = nextSlot.fetch_add(1, memory_order_relaxed) % EPOCH_READER_SLOTS;
+        return index;
+    }
+
+public:
+    // Guard - keeps every object reachable when it was created alive until it is destroyed
+    class Guard {
+    private:
+        atomic<uint64_t>* m_Counter;
+
+    public:
+        explicit Guard(EpochDomain& domain) {
+            ReaderSlot& slot = domain.m_Slots[slotIndex()];
+            while (true) {
+                uint64_t epoch = domain.m_Epoch.load();
+                m_Counter = &slot.active[epoch & 1];
+                m_Counter->fetch_add(1);
+                // The epoch moved before the reader was counted: the writer may
+                // not have seen it, count it in the new epoch instead
+                if (domain.m_Epoch.load() == epoch) {
+                    return;
+                }
+                m_Counter->fetch_sub(1, memory_order_release);
+            }
+        }
+
+        ~Guard() {
+            m_Counter->fetch_sub(1, memory_order_release);
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+
+    EpochDomain() = default;
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    // Destructor - frees every retired object, no reader may be left
+    ~EpochDomain() {
+        for (const Retired& retired : m_Retired) {
+            retired.destroy(retired.object);
+        }
+    }
+
+    // retire - frees an object once no reader can reach it, it must already be unpublished
+    // object: the object, allocated with new
+    template<typename T>
+    void retire(const T* object) {
+        m_Retired.push_back(Retired{m_Epoch.load(memory_order_relaxed), object,
+                                    [](const void* p) { delete static_cast<const T*>(p); }});
+        reclaim();
+    }
+
+    // reclaim - advances the epoch if no reader is left in the previous one and
+    // frees the objects retired two epochs ago or earlier
+    void reclaim() {
+        uint64_t epoch = m_Epoch.load(memory_order_relaxed);
+        // Readers of epoch - 1 count in the parity of epoch + 1
+        bool previousLeft = true;
+        for (ReaderSlot& slot : m_Slots) {
+            previousLeft &= slot.active[(epoch + 1) & 1].load(memory_order_acquire) == 0;
+        }
+        if (previousLeft) {
+            m_Epoch.store(++epoch);
+        }
+        size_t kept = 0;
+        for (Retired& retired : m_Retired) {
+            if (retired.epoch + 2 <= epoch) {
+                retired.destroy(retired.object);
+            } else {
+                m_Retired[kept++] = retired;
+            }
+        }
+        m_Retired.resize(kept);
+    }
+};
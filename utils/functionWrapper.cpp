@@ -1,24 +1,47 @@
-
 #include "functionWrapper.h"
 using namespace std;
 
 
 
-void functionWrapper::operator()() { 
-	impl->call(); 
+void functionWrapper::operator()() {
+	impl->call();
 }
 
 functionWrapper::functionWrapper()
 {
 }
 
+functionWrapper::~functionWrapper()
+{
+	reset();
+}
+
+void functionWrapper::reset()
+{
+	if (isInline()) {
+		impl->~implBase();
+	} else {
+		delete impl;
+	}
+	impl = nullptr;
+}
+
 functionWrapper::functionWrapper(functionWrapper&& other) noexcept{
-	impl = move(other.impl);
+	*this = move(other);
 }
 
 functionWrapper& functionWrapper::operator=(functionWrapper&& other) noexcept{
-	impl = move(other.impl);
+	if (this == &other) {
+		return *this;
+	}
+	reset();
+	if (other.isInline()) {
+		// The callable lives in the buffer of other, it has to be moved out
+		impl = other.impl->moveTo(m_Buffer);
+		other.reset();
+	} else {
+		impl = other.impl;
+		other.impl = nullptr;
+	}
 	return *this;
 }
-
-
@@ -1,13 +1,23 @@
 #pragma once
+#include <cstddef>
 #include <memory>
+#include <new>
+#include <type_traits>
 #include <utility>
 #include <functional>
 using namespace std;
 
+constexpr size_t FUNCTION_INLINE_SIZE{64}; // captures up to a cache line are stored without allocating
+
+// functionWrapper - move-only callable, like a std::function that accepts move-only
+// callables such as packaged_task. A callable of up to FUNCTION_INLINE_SIZE bytes
+// with a noexcept move constructor is stored inline, larger ones on the heap.
 class functionWrapper {
 private:
 	struct implBase {
 		virtual void call() = 0;
+		// moveTo - move constructs the callable into the inline buffer of another wrapper
+		virtual implBase* moveTo(void* buffer) noexcept = 0;
 		virtual ~implBase() {}
 	};
 
@@ -17,19 +27,38 @@ private:
 		F f;
 		implType(F&& f_) : f(move(f_)) {}
 		void call() { f(); }
+		implBase* moveTo(void* buffer) noexcept { return new (buffer) implType(move(f)); }
 	};
 
-	unique_ptr<implBase> impl;
+	template<typename F>
+	static constexpr bool fitsInline = sizeof(implType<F>) <= FUNCTION_INLINE_SIZE &&
+		alignof(implType<F>) <= alignof(max_align_t) && is_nothrow_move_constructible_v<F>;
+
+	alignas(max_align_t) unsigned char m_Buffer[FUNCTION_INLINE_SIZE];
+	implBase* impl{nullptr};
+
+	bool isInline() const { return impl == reinterpret_cast<const implBase*>(m_Buffer); }
+
+	// reset - destroys the callable
+	void reset();
 
 public:
-	template<typename F>
-	functionWrapper(F&& f) : impl(new implType<F>(move(f))){
-	};
-	
+	template<typename F, typename = enable_if_t<!is_same_v<decay_t<F>, functionWrapper>>>
+	functionWrapper(F&& f) {
+		using Stored = decay_t<F>;
+		if constexpr (fitsInline<Stored>) {
+			impl = new (m_Buffer) implType<Stored>(Stored(forward<F>(f)));
+		} else {
+			impl = new implType<Stored>(Stored(forward<F>(f)));
+		}
+	}
+
 	void operator()();
 
 	functionWrapper();
-	
+
+	~functionWrapper();
+
 	functionWrapper(functionWrapper&& other) noexcept;
 
 	functionWrapper& operator=(functionWrapper&& other) noexcept;
@@ -37,4 +66,3 @@ public:
 	functionWrapper(const functionWrapper&) = delete; // Disable copy constructor
 	functionWrapper& operator=(const functionWrapper&) = delete; // Disable copy assignment operator
 };
-
@@ -0,0 +1,186 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "sequencedRing.h"
+
+using namespace std;
+
+// MpmcQueue - bounded multi-producer, multi-consumer queue of Dmitry Vyukov. The
+// slots are preallocated; producers and consumers each claim a position with one
+// compare and swap on their own counter and never take a lock. Each slot sequence
+// tells whose turn it is:
+//   sequence == p                free for the producer of position p
+//   sequence == p + 1            published, readable by the consumer of position p
+//   sequence == p + capacity     released, free for the producer of the next lap
+// The bulk variants claim a run of consecutive ready slots with a single compare
+// and swap. push and waitAndPop block with a WaitStrategy when the queue is full
+// or empty; the try variants never wait.
+template<typename T>
+class MpmcQueue {
+private:
+    struct Slot {
+        atomic<uint64_t> sequence;
+        T value;
+    };
+
+    size_t m_Capacity;
+    size_t m_Mask;
+    unique_ptr<Slot[]> m_Slots;
+    alignas(64) atomic<uint64_t> m_Enqueue{0};  // next position claimed by a producer
+    alignas(64) atomic<uint64_t> m_Dequeue{0};  // next position claimed by a consumer
+    WaitStrategy m_NotFull;                     // producers blocked in push
+    WaitStrategy m_NotEmpty;                    // consumers blocked in waitAndPop
+
+    static size_t roundUpPowerOfTwo(size_t value) {
+        size_t capacity = 2;
+        while (capacity < value) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+    // claim - claims up to count consecutive positions whose slots have the sequence
+    // position + offset, offset being 0 for producers and 1 for consumers
+    // counter: m_Enqueue or m_Dequeue
+    // position: output parameter that receives the first claimed position
+    // Returns the number of positions claimed, 0 if the queue is full or empty
+    size_t claim(atomic<uint64_t>& counter, uint64_t offset, size_t count, uint64_t& position) {
+        position = counter.load(memory_order_relaxed);
+        while (true) {
+            size_t ready = 0;
+            while (ready < count) {
+                uint64_t sequence = m_Slots[(position + ready) & m_Mask].sequence.load(memory_order_acquire);
+                int64_t diff = static_cast<int64_t>(sequence - (position + ready + offset));
+                if (diff != 0) {
+                    if (ready == 0 && diff > 0) {
+                        // Another thread claimed the position, start over from the counter
+                        ready = SIZE_MAX;
+                    }
+                    break;
+                }
+                ++ready;
+            }
+            if (ready == SIZE_MAX) {
+                position = counter.load(memory_order_relaxed);
+                continue;
+            }
+            if (ready == 0) {
+                return 0;
+            }
+            // Every slot of the run was seen ready, nobody else can claim them once the counter moved
+            if (counter.compare_exchange_weak(position, position + ready, memory_order_relaxed)) {
+                return ready;
+            }
+        }
+    }
+
+public:
+    // Constructor
+    // capacity: number of slots, rounded up to a power of two
+    // mode: wait strategy of push and waitAndPop
+    explicit MpmcQueue(size_t capacity, WaitStrategy::Mode mode = WaitStrategy::YIELD)
+        : m_Capacity(roundUpPowerOfTwo(capacity)), m_Mask(m_Capacity - 1),
+          m_Slots(new Slot[m_Capacity]), m_NotFull(mode), m_NotEmpty(mode) {
+        for (size_t i = 0; i < m_Capacity; ++i) {
+            m_Slots[i].sequence.store(i, memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    // tryPush - adds a value unless the queue is full
+    // value: the value, moved from only when it was added
+    // Returns false if the queue is full
+    bool tryPush(T& value) {
+        return tryPushBulk(&value, 1) == 1;
+    }
+
+    bool tryPush(T&& value) {
+        return tryPush(value);
+    }
+
+    // tryPop - removes the oldest value unless the queue is empty
+    // value: output parameter that receives the value
+    // Returns false if the queue is empty
+    bool tryPop(T& value) {
+        return tryPopBulk(&value, 1) == 1;
+    }
+
+    // tryPushBulk - adds up to count values in order, as many as there are free slots
+    // first: iterator to the values, the added ones are moved from
+    // count: number of values available at first
+    // Returns the number of values added
+    template<typename InputIt>
+    size_t tryPushBulk(InputIt first, size_t count) {
+        uint64_t position;
+        size_t claimed = count > 0 ? claim(m_Enqueue, 0, count, position) : 0;
+        for (size_t i = 0; i < claimed; ++i, ++first) {
+            Slot& slot = m_Slots[(position + i) & m_Mask];
+            slot.value = move(*first);
+            slot.sequence.store(position + i + 1, memory_order_release);
+        }
+        if (claimed > 0) {
+            m_NotEmpty.signal();
+        }
+        return claimed;
+    }
+
+    // tryPopBulk - removes up to maxCount values, oldest first
+    // out: output iterator receiving the values
+    // maxCount: maximum number of values removed
+    // Returns the number of values removed
+    template<typename OutputIt>
+    size_t tryPopBulk(OutputIt out, size_t maxCount) {
+        uint64_t position;
+        size_t claimed = maxCount > 0 ? claim(m_Dequeue, 1, maxCount, position) : 0;
+        for (size_t i = 0; i < claimed; ++i) {
+            Slot& slot = m_Slots[(position + i) & m_Mask];
+            *out = move(slot.value);
+            ++out;
+            slot.value = T{};
+            slot.sequence.store(position + i + m_Capacity, memory_order_release);
+        }
+        if (claimed > 0) {
+            m_NotFull.signal();
+        }
+        return claimed;
+    }
+
+    // push - adds a value, waiting with the wait strategy while the queue is full
+    // value: the value
+    void push(T value) {
+        while (!tryPush(value)) {
+            m_NotFull.waitUntil([this] { return size() < m_Capacity; });
+        }
+    }
+
+    // waitAndPop - removes the oldest value, waiting with the wait strategy while the queue is empty
+    // value: output parameter that receives the value
+    void waitAndPop(T& value) {
+        while (!tryPop(value)) {
+            m_NotEmpty.waitUntil([this] { return !empty(); });
+        }
+    }
+
+    // size - number of claimed values not popped yet (approximate while other threads run)
+    size_t size() const {
+        uint64_t dequeue = m_Dequeue.load(memory_order_relaxed);
+        uint64_t enqueue = m_Enqueue.load(memory_order_relaxed);
+        return enqueue > dequeue ? static_cast<size_t>(enqueue - dequeue) : 0;
+    }
+
+    // empty - whether the queue looked empty, approximate while other threads run
+    bool empty() const {
+        return size() == 0;
+    }
+
+    // capacity - number of slots
+    size_t capacity() const {
+        return m_Capacity;
+    }
+};
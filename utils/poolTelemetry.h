@@ -0,0 +1,185 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <immintrin.h>
+#endif
+
+using namespace std;
+
+// The ThreadPool records telemetry only when built with THREAD_POOL_TELEMETRY,
+// otherwise its hooks compile to nothing and snapshots come back empty
+#ifdef THREAD_POOL_TELEMETRY
+constexpr bool POOL_TELEMETRY_ENABLED{true};
+#else
+constexpr bool POOL_TELEMETRY_ENABLED{false};
+#endif
+
+constexpr size_t TELEMETRY_BUCKETS{64};         // bucket b counts durations of bit width b, [2^(b-1), 2^b) ticks
+constexpr uint64_t TELEMETRY_SAMPLE_INTERVAL{32}; // one task in this many is timed, a timestamp costs more than the counters
+
+// telemetryTicks - cheap timestamp of the pool telemetry: the TSC on x86, steady_clock elsewhere
+inline uint64_t telemetryTicks() {
+#if defined(__x86_64__) || defined(_M_X64)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// sampleStamp - timestamp of a task to time, 0 for the others
+// sequence: number of tasks counted before this one by the same writer
+inline uint64_t sampleStamp(uint64_t sequence) {
+    return sequence % TELEMETRY_SAMPLE_INTERVAL == 0 ? telemetryTicks() : 0;
+}
+
+// HistogramSnapshot - copy of one or more TickHistograms, in nanoseconds
+struct HistogramSnapshot {
+    uint64_t buckets[TELEMETRY_BUCKETS]{};
+    uint64_t count{0};          // timed tasks, about one in TELEMETRY_SAMPLE_INTERVAL
+    uint64_t sumTicks{0};
+    double nsPerTick{1.0};
+
+    // meanNs - average duration
+    double meanNs() const {
+        return count == 0 ? 0.0 : sumTicks * nsPerTick / count;
+    }
+
+    // percentileNs - upper bound of the bucket holding the given percentile, within a factor of two
+    // percentile: between 0 and 100
+    double percentileNs(double percentile) const {
+        uint64_t rank = static_cast<uint64_t>(count * percentile / 100.0);
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < TELEMETRY_BUCKETS; ++bucket) {
+            seen += buckets[bucket];
+            if (seen > rank) {
+                return bucket == 0 ? 0.0 : static_cast<double>(1ull << (bucket - 1)) * 2 * nsPerTick;
+            }
+        }
+        return 0.0;
+    }
+
+    void add(const HistogramSnapshot& other) {
+        for (size_t bucket = 0; bucket < TELEMETRY_BUCKETS; ++bucket) {
+            buckets[bucket] += other.buckets[bucket];
+        }
+        count += other.count;
+        sumTicks += other.sumTicks;
+    }
+};
+
+// TickHistogram - log2 histogram of durations in telemetry ticks. One thread
+// records, any thread reads: the counters are relaxed atomics updated with a
+// plain load and store, no read-modify-write.
+class TickHistogram {
+private:
+    atomic<uint64_t> m_Buckets[TELEMETRY_BUCKETS]{};
+    atomic<uint64_t> m_Count{0};
+    atomic<uint64_t> m_SumTicks{0};
+
+    static void bump(atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(counter.load(memory_order_relaxed) + value, memory_order_relaxed);
+    }
+
+public:
+    // record - adds one duration, owner thread only
+    void record(uint64_t ticks) {
+        size_t bucket = static_cast<size_t>(bit_width(ticks));
+        bump(m_Buckets[bucket < TELEMETRY_BUCKETS ? bucket : TELEMETRY_BUCKETS - 1], 1);
+        bump(m_Count, 1);
+        bump(m_SumTicks, ticks);
+    }
+
+    // snapshot - copies the counters, approximate while the owner records
+    HistogramSnapshot snapshot(double nsPerTick) const {
+        HistogramSnapshot copy;
+        for (size_t bucket = 0; bucket < TELEMETRY_BUCKETS; ++bucket) {
+            copy.buckets[bucket] = m_Buckets[bucket].load(memory_order_relaxed);
+        }
+        copy.count = m_Count.load(memory_order_relaxed);
+        copy.sumTicks = m_SumTicks.load(memory_order_relaxed);
+        copy.nsPerTick = nsPerTick;
+        return copy;
+    }
+};
+
+// WorkerTelemetry - counters of one pool worker, written by that worker only
+struct alignas(64) WorkerTelemetry {
+    atomic<uint64_t> enqueued{0};   // tasks the worker enqueued to its own deque
+    atomic<uint64_t> completed{0};
+    atomic<uint64_t> stolen{0};     // tasks the worker stole from another worker
+    TickHistogram wait;             // enqueue to start of the timed tasks
+    TickHistogram run;              // start to end of the timed tasks
+
+    static void bump(atomic<uint64_t>& counter) {
+        counter.store(counter.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+};
+
+// WorkerTelemetrySnapshot - copy of the counters of one worker
+struct WorkerTelemetrySnapshot {
+    uint64_t enqueued{0};
+    uint64_t completed{0};
+    uint64_t stolen{0};
+    HistogramSnapshot wait;
+    HistogramSnapshot run;
+};
+
+// PoolTelemetrySnapshot - counters of a pool and of each of its workers
+struct PoolTelemetrySnapshot {
+    bool enabled{POOL_TELEMETRY_ENABLED};
+    uint64_t enqueued{0};       // by workers and by outside threads
+    uint64_t completed{0};
+    uint64_t stolen{0};
+    uint64_t depth{0};          // enqueued and not completed, running tasks included
+    size_t injected{0};         // waiting in the injection queue
+    HistogramSnapshot wait;
+    HistogramSnapshot run;
+    vector<WorkerTelemetrySnapshot> workers;
+
+    // format - one line summary followed by a line per worker
+    string format() const {
+        if (!enabled) {
+            return "thread pool telemetry is not compiled in (THREAD_POOL_TELEMETRY)";
+        }
+        ostringstream out;
+        out.setf(ios::fixed);
+        out.precision(0);
+        out << "pool enqueued=" << enqueued << " completed=" << completed << " stolen=" << stolen
+            << " depth=" << depth << " injected=" << injected
+            << " timed=" << run.count << " wait_ns mean=" << wait.meanNs() << " p50=" << wait.percentileNs(50) << " p99=" << wait.percentileNs(99)
+            << " run_ns mean=" << run.meanNs() << " p50=" << run.percentileNs(50) << " p99=" << run.percentileNs(99);
+        for (size_t i = 0; i < workers.size(); ++i) {
+            const WorkerTelemetrySnapshot& worker = workers[i];
+            out << "\n  worker " << i << " enqueued=" << worker.enqueued << " completed=" << worker.completed
+                << " stolen=" << worker.stolen << " wait_p99_ns=" << worker.wait.percentileNs(99)
+                << " run_p99_ns=" << worker.run.percentileNs(99);
+        }
+        return out.str();
+    }
+};
+
+// TickCalibration - converts telemetry ticks to nanoseconds against steady_clock,
+// measured from construction to the call so it needs no sleep
+class TickCalibration {
+private:
+    uint64_t m_StartTicks{telemetryTicks()};
+    chrono::steady_clock::time_point m_Start{chrono::steady_clock::now()};
+
+public:
+    double nsPerTick() const {
+#if defined(__x86_64__) || defined(_M_X64)
+        uint64_t ticks = telemetryTicks() - m_StartTicks;
+        double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - m_Start).count();
+        return ticks == 0 ? 1.0 : ns / ticks;
+#else
+        return chrono::duration<double, nano>(chrono::steady_clock::duration(1)).count();
+#endif
+    }
+};
@@ -0,0 +1,187 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "cpuRelax.h"
+
+using namespace std;
+
+// WaitStrategy - how a thread waits for a SequencedRing slot or entry.
+//   SPIN   busy-waits, lowest latency, burns a core per waiting thread
+//   YIELD  spins briefly then yields the core between checks
+//   BLOCK  spins briefly then sleeps on a condition variable; signal() only
+//          takes the lock when a thread is actually asleep
+class WaitStrategy {
+public:
+    enum Mode { SPIN, YIELD, BLOCK };
+
+private:
+    static constexpr int SPIN_TRIES{100};
+    Mode m_Mode;
+    atomic<int> m_Sleepers{0};
+    mutex m_Mutex;
+    condition_variable m_Cv;
+
+public:
+    explicit WaitStrategy(Mode mode = YIELD) : m_Mode(mode) {}
+
+    Mode getMode() const { return m_Mode; }
+
+    // waitUntil - returns once ready() is true
+    // ready: predicate re-checked after every wait step
+    template<typename Predicate>
+    void waitUntil(Predicate&& ready) {
+        for (int tries = 0; !ready(); ++tries) {
+            if (m_Mode == SPIN || tries < SPIN_TRIES) {
+                cpuRelax();
+            } else if (m_Mode == YIELD) {
+                this_thread::yield();
+            } else {
+                unique_lock lock(m_Mutex);
+                m_Sleepers.fetch_add(1, memory_order_seq_cst);
+                atomic_thread_fence(memory_order_seq_cst);
+                m_Cv.wait(lock, [&] { return ready(); });
+                m_Sleepers.fetch_sub(1, memory_order_relaxed);
+                return;
+            }
+        }
+    }
+
+    // signal - wakes the threads sleeping in waitUntil, called after the state they wait on changed
+    void signal() {
+        if (m_Mode != BLOCK) {
+            return;
+        }
+        // Orders the caller's state change before the sleeper count is read
+        atomic_thread_fence(memory_order_seq_cst);
+        if (m_Sleepers.load(memory_order_seq_cst) > 0) {
+            lock_guard lock(m_Mutex);
+            m_Cv.notify_all();
+        }
+    }
+};
+
+// SequencedRing - preallocated multi-producer, single-consumer ring in the style
+// of the LMAX Disruptor. Producers claim a sequence with one atomic fetch_add and
+// publish the slot by advancing its sequence number; there is no shared lock. The
+// consumer takes every published entry in one batch and hands the slots back.
+// Each slot sequence tells whose turn it is:
+//   sequence == s            free for the producer that claimed s
+//   sequence == s + 1        published, readable by the consumer at s
+//   sequence == s + capacity released, free for the producer of the next lap
+template<typename T>
+class SequencedRing {
+private:
+    struct Slot {
+        atomic<uint64_t> sequence;
+        T value;
+    };
+
+    size_t m_Capacity;
+    size_t m_Mask;
+    unique_ptr<Slot[]> m_Slots;
+    alignas(64) atomic<uint64_t> m_Claimed{0};   // next sequence handed to a producer
+    alignas(64) atomic<uint64_t> m_Consumed{0};  // next sequence read by the consumer
+    WaitStrategy m_ProducerWait;                 // producers waiting for a full ring to drain
+    WaitStrategy m_ConsumerWait;                 // consumer waiting in waitAndDrain
+
+    static size_t roundUpPowerOfTwo(size_t value) {
+        size_t capacity = 2;
+        while (capacity < value) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+public:
+    // Constructor
+    // capacity: number of slots, rounded up to a power of two
+    // mode: wait strategy of the producers on a full ring and of waitAndDrain
+    explicit SequencedRing(size_t capacity, WaitStrategy::Mode mode = WaitStrategy::YIELD)
+        : m_Capacity(roundUpPowerOfTwo(capacity)), m_Mask(m_Capacity - 1),
+          m_Slots(new Slot[m_Capacity]), m_ProducerWait(mode), m_ConsumerWait(mode) {
+        for (size_t i = 0; i < m_Capacity; ++i) {
+            m_Slots[i].sequence.store(i, memory_order_relaxed);
+        }
+    }
+
+    SequencedRing(const SequencedRing&) = delete;
+    SequencedRing& operator=(const SequencedRing&) = delete;
+
+    // push - claims the next sequence, waits while the ring is full and publishes the value
+    // value: the entry to publish
+    // onFull: called once before waiting for a full ring, wakes a consumer that drains on demand
+    // Returns the number of entries pending after this one, for batching decisions
+    template<typename OnFull>
+    size_t push(T value, OnFull&& onFull) {
+        uint64_t sequence = m_Claimed.fetch_add(1, memory_order_relaxed);
+        Slot& slot = m_Slots[sequence & m_Mask];
+        if (slot.sequence.load(memory_order_acquire) != sequence) {
+            onFull();
+            m_ProducerWait.waitUntil([&] { return slot.sequence.load(memory_order_acquire) == sequence; });
+        }
+        slot.value = move(value);
+        slot.sequence.store(sequence + 1, memory_order_release);
+        m_ConsumerWait.signal();
+        return static_cast<size_t>(sequence + 1 - m_Consumed.load(memory_order_relaxed));
+    }
+
+    // push - push for a consumer that polls the ring, nothing to wake on a full ring
+    size_t push(T value) {
+        return push(move(value), [] {});
+    }
+
+    // drain - hands every published entry to handler, in sequence order. Single consumer only.
+    // handler: callable receiving a T&& for every entry
+    // maxBatch: maximum number of entries taken
+    // Returns the number of entries handled
+    template<typename Handler>
+    size_t drain(Handler&& handler, size_t maxBatch = SIZE_MAX) {
+        uint64_t sequence = m_Consumed.load(memory_order_relaxed);
+        size_t count = 0;
+        while (count < maxBatch) {
+            Slot& slot = m_Slots[sequence & m_Mask];
+            if (slot.sequence.load(memory_order_acquire) != sequence + 1) {
+                break;
+            }
+            handler(move(slot.value));
+            slot.value = T{};
+            slot.sequence.store(sequence + m_Capacity, memory_order_release);
+            ++sequence;
+            ++count;
+        }
+        if (count > 0) {
+            m_Consumed.store(sequence, memory_order_release);
+            m_ProducerWait.signal();
+        }
+        return count;
+    }
+
+    // waitAndDrain - waits with the ring wait strategy until an entry is published, then drains
+    // handler: callable receiving a T&& for every entry
+    // maxBatch: maximum number of entries taken
+    // Returns the number of entries handled
+    template<typename Handler>
+    size_t waitAndDrain(Handler&& handler, size_t maxBatch = SIZE_MAX) {
+        uint64_t sequence = m_Consumed.load(memory_order_relaxed);
+        Slot& slot = m_Slots[sequence & m_Mask];
+        m_ConsumerWait.waitUntil([&] { return slot.sequence.load(memory_order_acquire) == sequence + 1; });
+        return drain(handler, maxBatch);
+    }
+
+    // size - number of claimed entries not consumed yet (approximate while producers run)
+    size_t size() const {
+        uint64_t consumed = m_Consumed.load(memory_order_relaxed);
+        return static_cast<size_t>(m_Claimed.load(memory_order_relaxed) - consumed);
+    }
+
+    // capacity - number of slots
+    size_t capacity() const {
+        return m_Capacity;
+    }
+};
@@ -1,7 +1,11 @@
+#include <algorithm>
+#include <utility>
+
 #include "threadPool.h"
 #include "functionWrapper.h"
 
-threadPool_::threadPool_(vector<thread> &threads) : m_Joiner(threads) {
+threadPool_::threadPool_(vector<thread> &threads, unsigned spinCount, unsigned yieldCount)
+	: m_SpinCount(max(spinCount, MIN_POOL_SPINS)), m_YieldCount(yieldCount), m_Joiner(threads) {
 	int const num_threads = thread::hardware_concurrency();// Get the number of hardware threads available
 	try {
 		for (size_t i = 0; i < num_threads; ++i) {
@@ -15,23 +19,65 @@ threadPool_::threadPool_(vector<thread> &threads) : m_Joiner(threads) {
 }
 
 void threadPool_::WorkerThread() {
+	unsigned spinLimit = m_SpinCount;
 	while (!m_Done) {
 		functionWrapper task;
 		if (m_WorkQueue.tryPop(task)) {
+			m_Pending.fetch_sub(1, memory_order_relaxed);
 			task();
 		} else {
-			this_thread::yield(); // Yield to avoid busy waiting
+			waitForWork(spinLimit);
+		}
+	}
+}
+
+void threadPool_::waitForWork(unsigned& spinLimit) {
+	auto ready = [this] {
+		return m_Pending.load(memory_order_relaxed) > 0 || m_Done.load(memory_order_relaxed);
+	};
+	for (unsigned i = 0; i < spinLimit + m_YieldCount; ++i) {
+		if (ready()) {
+			spinLimit = min(spinLimit * 2, m_SpinCount);
+			return;
 		}
+		if (i < spinLimit) {
+			cpuRelax();
+		} else {
+			this_thread::yield();
+		}
+	}
+	spinLimit = max(spinLimit / 2, MIN_POOL_SPINS);
+	// Announce the park before the last look, a submit after it wakes us
+	uint32_t signal = m_WakeSignal.load(memory_order_acquire);
+	m_Sleepers.fetch_add(1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	if (!ready()) {
+		m_WakeSignal.wait(signal, memory_order_acquire);
+	}
+	m_Sleepers.fetch_sub(1, memory_order_relaxed);
+}
+
+void threadPool_::notifyWorker() {
+	m_Pending.fetch_add(1, memory_order_relaxed);
+	// Pairs with the fence of a parking worker: either it sees the pending
+	// task, or this thread sees it counted in m_Sleepers
+	atomic_thread_fence(memory_order_seq_cst);
+	if (m_Sleepers.load(memory_order_relaxed) > 0) {
+		m_WakeSignal.fetch_add(1, memory_order_release);
+		m_WakeSignal.notify_one();
 	}
 }
 
 threadPool_::~threadPool_() {
 	m_Done.store(true); // Signal the worker threads to stop
+	m_WakeSignal.fetch_add(1, memory_order_release);
+	m_WakeSignal.notify_all();
 }
 
 void threadPool_::runPendingTasks() {
 	functionWrapper task;
 	if (m_WorkQueue.tryPop(task)) {
+		m_Pending.fetch_sub(1, memory_order_relaxed);
 		task(); // Execute the task
 	}
 	else{
@@ -39,37 +85,270 @@ void threadPool_::runPendingTasks() {
 	}	
 }
 
-ThreadPool::ThreadPool(size_t numThreads) : stop(false) {
-    for (size_t i = 0; i < numThreads; ++i)
-        workers.emplace_back([this] {
-            while (true) {
-                function<void()> task;
-                {
-                    unique_lock<mutex> lock(queueMutex);
-                    condition.wait(lock, [this] { return stop || !tasks.empty(); });
-                    if (stop && tasks.empty()) return;
-                    task = move(tasks.front());
-                    tasks.pop();
-                }
-                task();
-            }
-        });
+// Worker of the calling thread, enqueue pushes to its deque without a lock
+static thread_local ThreadPool* t_Pool = nullptr;
+static thread_local size_t t_WorkerIndex = 0;
+
+constexpr size_t INJECT_BATCH{32};  // injected tasks a worker moves to its deque at once
+constexpr int STEAL_ROUNDS{2};      // passes over the victims before a worker parks
+constexpr size_t FREE_BATCH{64};    // nodes a worker hands back for the injecting threads at once
+
+ThreadPool::ThreadPool(size_t numThreads) {
+	numThreads = max<size_t>(1, numThreads);
+	for (size_t i = 0; i < numThreads; ++i) {
+		m_Workers.push_back(make_unique<Worker>());
+		m_Workers.back()->random = 0x9E3779B97F4A7C15ull * (i + 1);
+	}
+	// Threads start once every worker exists, a thief never sees a partial vector
+	for (size_t i = 0; i < numThreads; ++i) {
+		m_Threads.emplace_back(&ThreadPool::workerLoop, this, i);
+	}
 }
 
 ThreadPool::~ThreadPool() {
+	m_Stop.store(true);
+	m_WakeSignal.fetch_add(1, memory_order_release);
+	m_WakeSignal.notify_all();
+	for (thread &worker : m_Threads) {
+		worker.join();
+	}
+	auto freeList = [](Task* node) {
+		while (node != nullptr) {
+			delete exchange(node, node->next);
+		}
+	};
+	freeList(m_FreeTasks);
+	for (unique_ptr<Worker>& worker : m_Workers) {
+		freeList(worker->freeTasks);
+	}
+}
+
+ThreadPool::Worker* ThreadPool::currentWorker() const {
+	return t_Pool == this ? m_Workers[t_WorkerIndex].get() : nullptr;
+}
+
+void ThreadPool::wakeWorker() {
+	// Pairs with the fence of a parking worker: either it sees the new task,
+	// or this thread sees it counted in m_Sleepers
+	atomic_thread_fence(memory_order_seq_cst);
+	if (m_Sleepers.load(memory_order_relaxed) > 0) {
+		m_WakeSignal.fetch_add(1, memory_order_release);
+		m_WakeSignal.notify_one();
+	}
+}
+
+void ThreadPool::workerLoop(size_t index) {
+	t_Pool = this;
+	t_WorkerIndex = index;
+	Task* task = nullptr;
+	while (true) {
+		if (findTask(index, task)) {
+			runTask(*m_Workers[index], task);
+			continue;
+		}
+		// Announce the park before the last look, an enqueue after it wakes us
+		uint32_t signal = m_WakeSignal.load(memory_order_acquire);
+		m_Sleepers.fetch_add(1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+		if (findTask(index, task)) {
+			m_Sleepers.fetch_sub(1, memory_order_relaxed);
+			runTask(*m_Workers[index], task);
+			continue;
+		}
+		if (m_Stop.load()) {
+			m_Sleepers.fetch_sub(1, memory_order_relaxed);
+			return;
+		}
+		m_WakeSignal.wait(signal, memory_order_acquire);
+		m_Sleepers.fetch_sub(1, memory_order_relaxed);
+	}
+}
+
+void ThreadPool::runTask(Worker& self, Task* task) {
+#ifdef THREAD_POOL_TELEMETRY
+	if (task->enqueuedAt != 0) {
+		uint64_t start = telemetryTicks();
+		// Clamped, the stamps of two cores may disagree by a few ticks
+		self.telemetry.wait.record(start > task->enqueuedAt ? start - task->enqueuedAt : 0);
+		task->task();
+		uint64_t end = telemetryTicks();
+		self.telemetry.run.record(end > start ? end - start : 0);
+	} else {
+		task->task();
+	}
+	WorkerTelemetry::bump(self.telemetry.completed);
+#else
+	task->task();
+#endif
+	task->task = functionWrapper(); // release the captures now, not when the node is reused
+	task->next = self.freeTasks;
+	self.freeTasks = task;
+	if (++self.freeCount < 2 * FREE_BATCH) {
+		return;
+	}
+	// The injecting threads only reuse nodes returned here, hand a batch back
+	Task* last = self.freeTasks;
+	for (size_t i = 1; i < FREE_BATCH; ++i) {
+		last = last->next;
+	}
+	Task* batch = self.freeTasks;
+	self.freeTasks = last->next;
+	self.freeCount -= FREE_BATCH;
+	lock_guard lock(m_InjectMutex);
+	last->next = m_FreeTasks;
+	m_FreeTasks = batch;
+}
+
+PoolTelemetrySnapshot ThreadPool::telemetry() const {
+	PoolTelemetrySnapshot snapshot;
+#ifdef THREAD_POOL_TELEMETRY
+	double nsPerTick = m_Calibration.nsPerTick();
+	snapshot.wait.nsPerTick = nsPerTick;
+	snapshot.run.nsPerTick = nsPerTick;
+	// Completed is summed first, a task finishing meanwhile shows up in depth rather than below zero
+	uint64_t completed = 0;
+	for (const unique_ptr<Worker>& worker : m_Workers) {
+		completed += worker->telemetry.completed.load(memory_order_relaxed);
+	}
+	snapshot.enqueued = m_InjectedTotal.load(memory_order_relaxed);
+	for (const unique_ptr<Worker>& worker : m_Workers) {
+		const WorkerTelemetry& counters = worker->telemetry;
+		WorkerTelemetrySnapshot copy;
+		copy.enqueued = counters.enqueued.load(memory_order_relaxed);
+		copy.completed = counters.completed.load(memory_order_relaxed);
+		copy.stolen = counters.stolen.load(memory_order_relaxed);
+		copy.wait = counters.wait.snapshot(nsPerTick);
+		copy.run = counters.run.snapshot(nsPerTick);
+		snapshot.enqueued += copy.enqueued;
+		snapshot.completed += copy.completed;
+		snapshot.stolen += copy.stolen;
+		snapshot.wait.add(copy.wait);
+		snapshot.run.add(copy.run);
+		snapshot.workers.push_back(copy);
+	}
+	snapshot.depth = snapshot.enqueued > completed ? snapshot.enqueued - completed : 0;
+	snapshot.injected = m_InjectedCount.load(memory_order_relaxed);
+#endif
+	return snapshot;
+}
+
+bool ThreadPool::findTask(size_t index, Task*& task) {
+	return m_Workers[index]->deque.take(task) || takeInjected(index, task) || stealTask(index, task);
+}
+
+bool ThreadPool::takeInjected(size_t index, Task*& task) {
+	if (m_InjectedCount.load(memory_order_acquire) == 0) {
+		return false;
+	}
+	Worker& self = *m_Workers[index];
+	size_t batch;
 	{
-		lock_guard<mutex> lock(queueMutex);
-		stop = true;
+		lock_guard lock(m_InjectMutex);
+		if (m_InjectedHead == nullptr) {
+			return false;
+		}
+		// Leave a share for the other workers, the rest of the batch can be stolen
+		size_t queued = m_InjectedCount.load(memory_order_relaxed);
+		batch = min({INJECT_BATCH, queued, queued / m_Workers.size() + 1});
+		task = m_InjectedHead;
+		m_InjectedHead = task->next;
+		for (size_t i = 1; i < batch; ++i) {
+			self.deque.push(m_InjectedHead);
+			m_InjectedHead = m_InjectedHead->next;
+		}
+		if (m_InjectedHead == nullptr) {
+			m_InjectedTail = nullptr;
+		}
+		m_InjectedCount.fetch_sub(batch, memory_order_relaxed);
 	}
-	condition.notify_all();
-	for (thread &worker : workers)
-		worker.join();
+	if (batch > 1) {
+		wakeWorker();
+	}
+	return true;
+}
+
+bool ThreadPool::stealTask(size_t index, Task*& task) {
+	size_t count = m_Workers.size();
+	if (count < 2) {
+		return false;
+	}
+	Worker& self = *m_Workers[index];
+	self.random ^= self.random << 13;
+	self.random ^= self.random >> 7;
+	self.random ^= self.random << 17;
+	size_t start = static_cast<size_t>(self.random % count);
+	for (int round = 0; round < STEAL_ROUNDS; ++round) {
+		for (size_t i = 0; i < count; ++i) {
+			size_t victim = (start + i) % count;
+			if (victim != index && m_Workers[victim]->deque.steal(task)) {
+#ifdef THREAD_POOL_TELEMETRY
+				WorkerTelemetry::bump(self.telemetry.stolen);
+#endif
+				return true;
+			}
+		}
+	}
+	return false;
 }
 
-void ThreadPool::enqueue(function<void()> task) {
-    {
-        lock_guard<mutex> lock(queueMutex);
-        tasks.push(move(task));
-    }
-    condition.notify_one();
+Strand::Strand(ThreadPool& pool) : m_Pool(pool), m_Tail(&m_Stub), m_Head(&m_Stub) {
+}
+
+Strand::~Strand() {
+	// No drain is running or scheduled any more, free what was never run
+	while (Node* node = pop()) {
+		delete node;
+	}
+}
+
+void Strand::push(Node* node) {
+	node->next.store(nullptr, memory_order_relaxed);
+	Node* previous = m_Tail.exchange(node, memory_order_acq_rel);
+	previous->next.store(node, memory_order_release);
+}
+
+Strand::Node* Strand::pop() {
+	Node* head = m_Head;
+	Node* next = head->next.load(memory_order_acquire);
+	if (head == &m_Stub) {
+		if (next == nullptr) {
+			return nullptr;
+		}
+		m_Head = next;
+		head = next;
+		next = next->next.load(memory_order_acquire);
+	}
+	if (next != nullptr) {
+		m_Head = next;
+		return head;
+	}
+	if (head != m_Tail.load(memory_order_acquire)) {
+		// A producer swapped the tail and is about to link its node
+		return nullptr;
+	}
+	// head is the last node: put the stub behind it so it can be unlinked
+	push(&m_Stub);
+	next = head->next.load(memory_order_acquire);
+	if (next != nullptr) {
+		m_Head = next;
+		return head;
+	}
+	return nullptr;
+}
+
+void Strand::drain() {
+	for (size_t ran = 0; ran < STRAND_BATCH; ++ran) {
+		Node* node;
+		// Counted tasks are pushed already, a null pop is a producer halfway through push
+		while ((node = pop()) == nullptr) {
+			cpuRelax();
+		}
+		node->task();
+		delete node;
+		if (m_Pending.fetch_sub(1, memory_order_acq_rel) == 1) {
+			return;
+		}
+	}
+	// Tasks remain, let the other work of this worker run before them
+	m_Pool.enqueue([this] { drain(); });
 }
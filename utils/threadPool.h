@@ -8,9 +8,15 @@
 #include <queue>
 #include <mutex>
 #include <condition_variable>
+#include <deque>
+#include <memory>
+#include <algorithm>
 
 #include "threadSafeQueue.h"
+#include "chaseLevDeque.h"
+#include "cpuRelax.h"
 #include "functionWrapper.h"
+#include "poolTelemetry.h"
 
 
 using namespace std;
@@ -30,17 +36,42 @@ struct joinableThread {
 	}
 };
 
+constexpr unsigned DEFAULT_POOL_SPINS{1000}; // cpuRelax rounds of an idle worker before it yields
+constexpr unsigned DEFAULT_POOL_YIELDS{16};  // yields of an idle worker before it parks
+constexpr unsigned MIN_POOL_SPINS{16};       // lower bound of the adaptive spin
+
+// threadPool_ - pool of one worker per hardware thread on a shared queue. An idle
+// worker spins on the pending task count, never on the queue lock, then yields a
+// few times and finally parks on an atomic wait until submit wakes it. The spin
+// adapts per worker: it is halved every time it ends in a park and doubled, up to
+// the configured count, every time it finds work.
 class threadPool_ {
 private:
     atomic_bool m_Done{ false };
 	threadSafeQueue<functionWrapper> m_WorkQueue; 
+	atomic<ptrdiff_t> m_Pending{0};     // tasks pushed and not popped yet, briefly -1 when a pop beats the count
+	atomic<uint32_t> m_WakeSignal{0};   // bumped to wake parked workers
+	atomic<int> m_Sleepers{0};          // workers parked or about to park
+	unsigned m_SpinCount;
+	unsigned m_YieldCount;
 	vector<thread> m_Threads;
 	joinableThread m_Joiner;
 
 	void WorkerThread();
 
+	// waitForWork - spins, yields and parks until a task is pending or the pool is done
+	// spinLimit: the adaptive spin count of the worker, updated
+	void waitForWork(unsigned& spinLimit);
+
+	// notifyWorker - wakes one parked worker, called after a task was pushed
+	void notifyWorker();
+
     public:
-	threadPool_(vector<thread>& threads);
+	// Constructor
+	// threads: receives the worker threads, joined when the pool is destroyed
+	// spinCount: cpuRelax rounds an idle worker spins before yielding
+	// yieldCount: yields an idle worker does before parking
+	threadPool_(vector<thread>& threads, unsigned spinCount = DEFAULT_POOL_SPINS, unsigned yieldCount = DEFAULT_POOL_YIELDS);
 	~threadPool_();
 
 	template<typename Function_Type>
@@ -49,6 +80,7 @@ private:
 		packaged_task<result_type()> task(move(f)); // Create a packaged task
 		future<result_type> res = task.get_future(); // Get the future from the packaged task
 		m_WorkQueue.push(move(task)); // Push the task to the work queue
+		notifyWorker();
 		return res; // Return the future to the caller
 	}
 	
@@ -61,23 +93,233 @@ private:
 		); // Create a packaged task with bound arguments
 		future<result_type> res = task.get_future(); // Get the future from the packaged task
 		m_WorkQueue.push(move(task)); // Push the task to the work queue
+		notifyWorker();
 		return res; // Return the future to the caller
 	}
 
+	// post - queues a task without a future, for callers that do not need its result
+	// f: the callable, stored inline in the queued functionWrapper if it is small enough
+	template<typename Function_Type>
+	void post(Function_Type&& f) {
+		m_WorkQueue.push(functionWrapper(forward<Function_Type>(f)));
+		notifyWorker();
+	}
+
 	void runPendingTasks();
 };
 
+// ThreadPool - work-stealing pool. Every worker owns a ChaseLevDeque: the tasks
+// it enqueues itself go to its own deque and are taken newest first, an idle
+// worker steals the oldest task of a random victim. Tasks enqueued by other
+// threads, like the epoll loop, go through one injection queue that workers drain
+// in batches into their deques. Idle workers park on an atomic wait, woken by enqueue.
+// Tasks live in recycled nodes holding a functionWrapper, so once the pool is warm
+// enqueueing a small callable allocates nothing.
+// Built with THREAD_POOL_TELEMETRY, every task is counted and one in
+// TELEMETRY_SAMPLE_INTERVAL is stamped when enqueued, started and finished; each
+// worker records its counters and histograms without read-modify-write atomics,
+// telemetry() sums them.
 class ThreadPool {
 public:
     ThreadPool(size_t numThreads);
     ~ThreadPool();
-    void enqueue(function<void()> task);
+
+    // telemetry - counters and histograms of the pool and of each worker, approximate
+    // while tasks run. enabled is false, and everything else zero, when the pool was
+    // built without THREAD_POOL_TELEMETRY.
+    PoolTelemetrySnapshot telemetry() const;
+
+    // enqueue - queues a task
+    // task: the callable, stored inline in a recycled node if it is small enough
+    template<typename F>
+    void enqueue(F&& task) {
+        functionWrapper wrapped(forward<F>(task));
+        if (Worker* self = currentWorker()) {
+            Task* node = self->freeTasks;
+            if (node != nullptr) {
+                self->freeTasks = node->next;
+                self->freeCount--;
+            } else {
+                node = new Task;
+            }
+            node->task = move(wrapped);
+#ifdef THREAD_POOL_TELEMETRY
+            node->enqueuedAt = sampleStamp(self->telemetry.enqueued.load(memory_order_relaxed));
+            WorkerTelemetry::bump(self->telemetry.enqueued);
+#endif
+            self->deque.push(node);
+        } else {
+            lock_guard lock(m_InjectMutex);
+            Task* node = m_FreeTasks;
+            if (node != nullptr) {
+                m_FreeTasks = node->next;
+            } else {
+                node = new Task;
+            }
+            node->task = move(wrapped);
+            node->next = nullptr;
+#ifdef THREAD_POOL_TELEMETRY
+            node->enqueuedAt = sampleStamp(m_InjectedTotal.load(memory_order_relaxed));
+            WorkerTelemetry::bump(m_InjectedTotal);
+#endif
+            (m_InjectedTail != nullptr ? m_InjectedTail->next : m_InjectedHead) = node;
+            m_InjectedTail = node;
+            m_InjectedCount.fetch_add(1, memory_order_release);
+        }
+        wakeWorker();
+    }
+
+private:
+    // Task - an enqueued task, linked into the injection queue or a free list
+    struct Task {
+        functionWrapper task;
+        Task* next{nullptr};
+#ifdef THREAD_POOL_TELEMETRY
+        uint64_t enqueuedAt{0};     // telemetryTicks() of the enqueue, 0 if the task is not timed
+#endif
+    };
+
+    struct alignas(64) Worker {
+        ChaseLevDeque<Task*> deque;
+        uint64_t random;            // xorshift state choosing the steal victims
+        Task* freeTasks{nullptr};   // nodes of tasks this worker ran, owner only
+        size_t freeCount{0};
+#ifdef THREAD_POOL_TELEMETRY
+        WorkerTelemetry telemetry;
+#endif
+    };
+
+    vector<unique_ptr<Worker>> m_Workers;
+    vector<thread> m_Threads;
+    mutex m_InjectMutex;
+    Task* m_InjectedHead{nullptr};          // tasks from threads outside the pool, guarded by m_InjectMutex
+    Task* m_InjectedTail{nullptr};
+    Task* m_FreeTasks{nullptr};             // nodes returned by the workers, guarded by m_InjectMutex
+    atomic<size_t> m_InjectedCount{0};      // length of the injection queue, read without the lock
+    atomic<uint32_t> m_WakeSignal{0};       // bumped to wake parked workers
+    atomic<int> m_Sleepers{0};              // workers parked or about to park
+    atomic<bool> m_Stop{false};
+#ifdef THREAD_POOL_TELEMETRY
+    atomic<uint64_t> m_InjectedTotal{0};    // tasks enqueued from outside the pool, written under m_InjectMutex
+    TickCalibration m_Calibration;
+#endif
+
+    // workerLoop - runs tasks until the pool is destroyed and no task is left
+    // index: index of the worker
+    void workerLoop(size_t index);
+
+    // findTask - takes a task from the own deque, the injection queue or another worker
+    // index: index of the worker looking for a task
+    // task: output parameter that receives the task
+    // Returns false if no task was found
+    bool findTask(size_t index, Task*& task);
+
+    // takeInjected - moves a batch of injected tasks to the deque of a worker
+    // index: index of the worker
+    // task: output parameter that receives the first task of the batch
+    // Returns false if the injection queue is empty
+    bool takeInjected(size_t index, Task*& task);
+
+    // stealTask - steals the oldest task of another worker, visiting them from a random one
+    // index: index of the thief
+    // task: output parameter that receives the task
+    // Returns false if nothing could be stolen
+    bool stealTask(size_t index, Task*& task);
+
+    // wakeWorker - unparks one worker if any is parked, called after a task was enqueued
+    void wakeWorker();
+
+    // currentWorker - the worker of the calling thread, nullptr outside this pool
+    Worker* currentWorker() const;
+
+    // runTask - runs a task and recycles its node
+    // self: the worker running it
+    // task: the task
+    void runTask(Worker& self, Task* task);
+};
+
+
+constexpr size_t STRAND_BATCH{64}; // tasks a strand runs before it yields its worker to other work
+
+// Strand - serial executor on a ThreadPool. Tasks posted to one strand run in
+// post order and never concurrently, tasks of different strands run on any worker.
+// Posting pushes onto an intrusive multi-producer, single-consumer queue with one
+// exchange and counts the task; only the post that raises the count from zero
+// schedules a drain on the pool, so there is no per-strand thread or lock. The
+// drain runs up to STRAND_BATCH tasks and then re-enqueues itself if tasks remain.
+// A strand must outlive the tasks posted to it.
+class Strand {
+public:
+    explicit Strand(ThreadPool& pool);
+    ~Strand();
+
+    Strand(const Strand&) = delete;
+    Strand& operator=(const Strand&) = delete;
+
+    // post - queues a task behind every task posted to this strand before it
+    // task: the callable
+    template<typename F>
+    void post(F&& task) {
+        Node* node = new Node{functionWrapper(forward<F>(task))};
+        push(node);
+        if (m_Pending.fetch_add(1, memory_order_acq_rel) == 0) {
+            m_Pool.enqueue([this] { drain(); });
+        }
+    }
 
 private:
-    vector<thread> workers;
-    queue<function<void()>> tasks;
-    mutex queueMutex;
-    condition_variable condition;
-    bool stop;
+    struct Node {
+        functionWrapper task;
+        atomic<Node*> next{nullptr};
+    };
+
+    ThreadPool& m_Pool;
+    alignas(64) atomic<Node*> m_Tail;   // last node, exchanged by the producers
+    alignas(64) Node* m_Head;           // next node to run, drain only
+    Node m_Stub;                        // placeholder keeping the queue non-empty
+    atomic<size_t> m_Pending{0};        // tasks posted and not run yet
+
+    // push - links a node at the tail, any thread
+    void push(Node* node);
+
+    // pop - unlinks the oldest node, drain only
+    // Returns nullptr if the queue is empty or a producer has not finished linking
+    Node* pop();
+
+    // drain - runs queued tasks, at most one drain runs at a time
+    void drain();
 };
 
+// StrandGroup - fixed set of strands picked by key, for serializing the work of
+// a connection or a room without creating a strand per key. Keys hashing to the
+// same strand share its order, which is still correct, only less parallel.
+template<typename Key, typename Hash = hash<Key>>
+class StrandGroup {
+public:
+    // Constructor
+    // pool: the pool running the tasks
+    // count: number of strands, a few times the worker count keeps keys apart
+    StrandGroup(ThreadPool& pool, size_t count) {
+        count = max<size_t>(1, count);
+        for (size_t i = 0; i < count; ++i) {
+            m_Strands.push_back(make_unique<Strand>(pool));
+        }
+    }
+
+    // strand - the strand serializing the tasks of a key
+    Strand& strand(const Key& key) {
+        return *m_Strands[m_Hash(key) % m_Strands.size()];
+    }
+
+    // post - queues a task behind every task posted for the same key
+    // key: the connection, room or other key to serialize on
+    // task: the callable
+    template<typename F>
+    void post(const Key& key, F&& task) {
+        strand(key).post(forward<F>(task));
+    }
+
+private:
+    vector<unique_ptr<Strand>> m_Strands;
+    Hash m_Hash;
+};
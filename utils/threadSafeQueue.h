@@ -5,12 +5,15 @@
 
 using namespace std;
 
+// threadSafeQueue - blocking FIFO queue. Values are stored in place, pushing
+// does not allocate a node per value; the shared_ptr overloads of the pops
+// allocate only for the callers that use them.
 template<typename T>
 class threadSafeQueue
 {
 private:
-	mutex m_Mutex;
-	queue<shared_ptr<T>> m_DataQueue;
+	mutable mutex m_Mutex;
+	queue<T> m_DataQueue;
 	condition_variable m_DataCond;
 
 public:
@@ -24,7 +27,7 @@ public:
 		m_DataCond.wait(lk, [this] {
 			return !m_DataQueue.empty(); 
 		});
-		value = move(*m_DataQueue.front());
+		value = move(m_DataQueue.front());
 		m_DataQueue.pop();
 	}
 
@@ -33,7 +36,7 @@ public:
 		lock_guard lk(m_Mutex);
 		if (m_DataQueue.empty())
 			return false;
-		value = move(*m_DataQueue.front());
+		value = move(m_DataQueue.front());
 		m_DataQueue.pop();
 		return true;
 	}
@@ -44,7 +47,7 @@ public:
 		m_DataCond.wait(lk, [this] {
 			return !m_DataQueue.empty(); 
 		});
-		shared_ptr<T> res = m_DataQueue.front();
+		shared_ptr<T> res = make_shared<T>(move(m_DataQueue.front()));
 		m_DataQueue.pop();
 		return res;
 	}
@@ -54,7 +57,7 @@ public:
 		lock_guard lk(m_Mutex);
 		if (m_DataQueue.empty())
 			return shared_ptr<T>();
-		shared_ptr<T> res = m_DataQueue.front();
+		shared_ptr<T> res = make_shared<T>(move(m_DataQueue.front()));
 		m_DataQueue.pop();
 		return res;
 	}
@@ -67,9 +70,8 @@ public:
 
 	void push(T new_value)
 	{
-		shared_ptr<T> data(make_shared<T>(move(new_value)));
 		lock_guard lk(m_Mutex);
-		m_DataQueue.push(data);
+		m_DataQueue.push(move(new_value));
 		m_DataCond.notify_one();
 	}
 }; 
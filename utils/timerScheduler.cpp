@@ -0,0 +1,71 @@
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+
+#include "timerScheduler.h"
+
+TimerScheduler::TimerScheduler(ThreadPool& pool, chrono::milliseconds tick)
+	: m_Pool(pool), m_Tick(max<Clock::duration>(tick, chrono::milliseconds(1))), m_Start(Clock::now()) {
+}
+
+TimerScheduler::~TimerScheduler() {
+	if (m_TimerFd != -1) {
+		close(m_TimerFd);
+	}
+}
+
+int TimerScheduler::init() {
+	m_TimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	return m_TimerFd == -1 ? -errno : 0;
+}
+
+uint64_t TimerScheduler::now() const {
+	return static_cast<uint64_t>((Clock::now() - m_Start) / m_Tick);
+}
+
+TimerId TimerScheduler::schedule(uint64_t delay, uint64_t period, functionWrapper task) {
+	lock_guard lock(m_Mutex);
+	uint64_t current = now();
+	// Catch up first so the delay counts from now, not from the last poll
+	m_Wheel.advance(current, [this](auto&& due) { run(forward<decltype(due)>(due)); });
+	TimerId id = m_Wheel.schedule(current + delay, period, move(task));
+	if (m_Wheel.nextWake() < m_Armed) {
+		arm();
+	}
+	return id;
+}
+
+bool TimerScheduler::cancel(TimerId id) {
+	// The timerfd stays armed, an early wakeup finds nothing due and re-arms
+	lock_guard lock(m_Mutex);
+	return m_Wheel.cancel(id);
+}
+
+size_t TimerScheduler::size() {
+	lock_guard lock(m_Mutex);
+	return m_Wheel.size();
+}
+
+void TimerScheduler::poll() {
+	uint64_t expirations;
+	while (read(m_TimerFd, &expirations, sizeof(expirations)) == -1 && errno == EINTR) {
+	}
+	lock_guard lock(m_Mutex);
+	m_Wheel.advance(now(), [this](auto&& due) { run(forward<decltype(due)>(due)); });
+	arm();
+}
+
+void TimerScheduler::arm() {
+	m_Armed = m_Wheel.nextWake();
+	struct itimerspec timeout{};
+	if (m_Armed != UINT64_MAX) {
+		auto since = (m_Start + m_Armed * m_Tick).time_since_epoch();
+		auto seconds = chrono::duration_cast<chrono::seconds>(since);
+		timeout.it_value.tv_sec = seconds.count();
+		timeout.it_value.tv_nsec = chrono::duration_cast<chrono::nanoseconds>(since - seconds).count();
+		if (timeout.it_value.tv_sec <= 0 && timeout.it_value.tv_nsec <= 0) {
+			timeout.it_value.tv_nsec = 1; // a zero value would disarm the timer
+		}
+	}
+	timerfd_settime(m_TimerFd, TFD_TIMER_ABSTIME, &timeout, nullptr);
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+#include "threadPool.h"
+#include "timerWheel.h"
+
+using namespace std;
+
+constexpr chrono::milliseconds DEFAULT_TIMER_TICK{1};
+
+// TimerScheduler - delayed and periodic tasks for a ThreadPool, on a TimerWheel
+// driven by one timerfd. Nothing sleeps: the owner watches fd() in its event loop
+// and calls poll() when it turns readable, due tasks are enqueued on the pool.
+// The timerfd is armed for the next occupied wheel slot only, so pending timers
+// far in the future cost no wakeups per tick. schedule and cancel take one mutex
+// and are O(1). Linux only.
+class TimerScheduler {
+public:
+    using Clock = chrono::steady_clock;
+
+    // Constructor
+    // pool: runs the due tasks
+    // tick: resolution of the wheel, delays are rounded up to it
+    explicit TimerScheduler(ThreadPool& pool, chrono::milliseconds tick = DEFAULT_TIMER_TICK);
+
+    // Destructor - closes the timerfd, pending tasks are dropped
+    ~TimerScheduler();
+
+    TimerScheduler(const TimerScheduler&) = delete;
+    TimerScheduler& operator=(const TimerScheduler&) = delete;
+
+    // init - creates the timerfd
+    // Returns 0 on success, -errno on failure
+    int init();
+
+    // fd - the timerfd to watch for EPOLLIN in the event loop
+    int fd() const { return m_TimerFd; }
+
+    // poll - enqueues every due task on the pool and re-arms the timerfd
+    void poll();
+
+    // scheduleAfter - runs a task once on the pool after delay
+    // Returns the id to cancel it with
+    template<typename Rep, typename Period, typename F>
+    TimerId scheduleAfter(chrono::duration<Rep, Period> delay, F&& task) {
+        return schedule(ticks(delay), 0, functionWrapper(forward<F>(task)));
+    }
+
+    // scheduleEvery - runs a task on the pool every period, first after one period.
+    // A run slower than the period overlaps the next one.
+    // Returns the id to cancel it with
+    template<typename Rep, typename Period, typename F>
+    TimerId scheduleEvery(chrono::duration<Rep, Period> period, F&& task) {
+        uint64_t periodTicks = ticks(period);
+        return schedule(periodTicks, periodTicks, functionWrapper(forward<F>(task)));
+    }
+
+    // cancel - stops a timer, a task already enqueued still runs
+    // Returns false if the timer already ran, was cancelled or is unknown
+    bool cancel(TimerId id);
+
+    // size - number of pending timers
+    size_t size();
+
+private:
+    ThreadPool& m_Pool;
+    Clock::duration m_Tick;
+    Clock::time_point m_Start;
+    int m_TimerFd{-1};
+    mutex m_Mutex;
+    TimerWheel m_Wheel;             // guarded by m_Mutex
+    uint64_t m_Armed{UINT64_MAX};   // tick the timerfd fires at, guarded by m_Mutex
+
+    // ticks - a delay in ticks, rounded up and at least one
+    template<typename Rep, typename Period>
+    uint64_t ticks(chrono::duration<Rep, Period> delay) const {
+        auto count = (chrono::duration_cast<Clock::duration>(delay) + m_Tick - Clock::duration(1)) / m_Tick;
+        return static_cast<uint64_t>(max<decltype(count)>(count, 1));
+    }
+
+    // run - enqueues a due one-shot task
+    void run(functionWrapper&& task) {
+        m_Pool.enqueue(move(task));
+    }
+
+    // run - enqueues one run of a due periodic task
+    void run(const shared_ptr<functionWrapper>& task) {
+        m_Pool.enqueue([task] { (*task)(); });
+    }
+
+    // now - the current tick
+    uint64_t now() const;
+
+    // schedule - adds a timer to the wheel and moves the timerfd earlier if needed
+    TimerId schedule(uint64_t delay, uint64_t period, functionWrapper task);
+
+    // arm - sets the timerfd to the next wheel wakeup, requires m_Mutex
+    void arm();
+};
@@ -0,0 +1,124 @@
+#include "timerWheel.h"
+
+constexpr uint64_t SLOT_MASK{TIMER_WHEEL_SLOTS - 1};
+constexpr uint64_t MAX_DELAY{(1ull << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOT_BITS)) - 1};
+
+TimerWheel::TimerWheel() {
+	fill(begin(m_Heads), end(m_Heads), NONE);
+}
+
+TimerId TimerWheel::schedule(uint64_t expiry, uint64_t period, functionWrapper task) {
+	uint32_t index;
+	if (!m_FreeNodes.empty()) {
+		index = m_FreeNodes.back();
+		m_FreeNodes.pop_back();
+	} else {
+		index = static_cast<uint32_t>(m_Nodes.size());
+		m_Nodes.emplace_back();
+	}
+	Node& node = m_Nodes[index];
+	node.expiry = clamp(expiry, m_Current + 1, m_Current + MAX_DELAY);
+	node.period = min(period, MAX_DELAY);
+	if (period == 0) {
+		node.task = move(task);
+	} else {
+		node.repeat = make_shared<functionWrapper>(move(task));
+	}
+	link(index);
+	m_Count++;
+	return (static_cast<uint64_t>(node.generation) << 32) | index;
+}
+
+bool TimerWheel::cancel(TimerId id) {
+	uint32_t index = static_cast<uint32_t>(id);
+	if (index >= m_Nodes.size() || m_Nodes[index].generation != static_cast<uint32_t>(id >> 32) ||
+		m_Nodes[index].slot == NONE) {
+		return false;
+	}
+	unlink(index);
+	release(index);
+	return true;
+}
+
+void TimerWheel::link(uint32_t index) {
+	Node& node = m_Nodes[index];
+	uint64_t delta = node.expiry - m_Current;
+	unsigned level = 0;
+	while (level + 1 < TIMER_WHEEL_LEVELS && delta >= (1ull << ((level + 1) * TIMER_WHEEL_SLOT_BITS))) {
+		level++;
+	}
+	uint32_t slot = static_cast<uint32_t>((node.expiry >> (level * TIMER_WHEEL_SLOT_BITS)) & SLOT_MASK);
+	uint32_t head = level * TIMER_WHEEL_SLOTS + slot;
+	node.slot = head;
+	node.prev = NONE;
+	node.next = m_Heads[head];
+	if (node.next != NONE) {
+		m_Nodes[node.next].prev = index;
+	}
+	m_Heads[head] = index;
+	m_Occupied[level][slot / 64] |= 1ull << (slot % 64);
+}
+
+void TimerWheel::unlink(uint32_t index) {
+	Node& node = m_Nodes[index];
+	if (node.prev != NONE) {
+		m_Nodes[node.prev].next = node.next;
+	} else {
+		m_Heads[node.slot] = node.next;
+	}
+	if (node.next != NONE) {
+		m_Nodes[node.next].prev = node.prev;
+	}
+	if (m_Heads[node.slot] == NONE) {
+		uint32_t level = node.slot / TIMER_WHEEL_SLOTS;
+		uint32_t slot = node.slot % TIMER_WHEEL_SLOTS;
+		m_Occupied[level][slot / 64] &= ~(1ull << (slot % 64));
+	}
+	node.slot = NONE;
+}
+
+void TimerWheel::release(uint32_t index) {
+	Node& node = m_Nodes[index];
+	node.task = functionWrapper();
+	node.repeat.reset();
+	node.generation++;
+	m_FreeNodes.push_back(index);
+	m_Count--;
+}
+
+void TimerWheel::cascade() {
+	// Highest level first: its timers may land in the level 1 slot cascaded next
+	unsigned top = 1;
+	while (top + 1 < TIMER_WHEEL_LEVELS && (m_Current & ((1ull << ((top + 1) * TIMER_WHEEL_SLOT_BITS)) - 1)) == 0) {
+		top++;
+	}
+	for (unsigned level = top; level >= 1; --level) {
+		uint32_t slot = static_cast<uint32_t>((m_Current >> (level * TIMER_WHEEL_SLOT_BITS)) & SLOT_MASK);
+		uint32_t head = level * TIMER_WHEEL_SLOTS + slot;
+		while (m_Heads[head] != NONE) {
+			uint32_t index = m_Heads[head];
+			unlink(index);
+			link(index);
+		}
+	}
+}
+
+uint64_t TimerWheel::nextOccupiedTick() const {
+	uint64_t boundary = (m_Current | SLOT_MASK) + 1;
+	// Level 0 slots after the current one, up to the end of this lap
+	uint32_t from = static_cast<uint32_t>((m_Current + 1) & SLOT_MASK);
+	if (from == 0) {
+		return boundary;
+	}
+	for (uint32_t word = from / 64; word < BITMAP_WORDS; ++word) {
+		uint64_t bits = m_Occupied[0][word];
+		if (word == from / 64) {
+			bits &= ~0ull << (from % 64);
+		}
+		if (bits != 0) {
+			uint32_t slot = word * 64 + static_cast<uint32_t>(__builtin_ctzll(bits));
+			return (m_Current & ~SLOT_MASK) + slot;
+		}
+	}
+	return boundary;
+}
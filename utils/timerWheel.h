@@ -0,0 +1,137 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "functionWrapper.h"
+
+using namespace std;
+
+constexpr unsigned TIMER_WHEEL_LEVELS{4};      // 4 levels of 256 slots span 2^32 ticks
+constexpr unsigned TIMER_WHEEL_SLOT_BITS{8};
+constexpr unsigned TIMER_WHEEL_SLOTS{1u << TIMER_WHEEL_SLOT_BITS};
+
+using TimerId = uint64_t; // generation in the high half, node index in the low half, 0 is never used
+
+// TimerWheel - hierarchical timing wheel in ticks. Level L holds the timers due
+// within 256^(L + 1) ticks in 256 slots of 256^L ticks each; when the level 0
+// position wraps, the due slot of the level above is cascaded down. Timers are
+// nodes of one vector linked by index into their slot, so schedule and cancel
+// are O(1) and a TimerId is checked against the node generation. A bitmap per
+// level lets advance skip empty slots. Delays past 2^32 ticks are clamped.
+// Not thread safe, TimerScheduler serializes the callers.
+class TimerWheel {
+public:
+    TimerWheel();
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // schedule - adds a timer
+    // expiry: tick the timer is due at, at least the next tick
+    // period: ticks between two runs of a periodic timer, 0 for a one-shot timer
+    // task: the callable, shared by every run of a periodic timer
+    // Returns the id used to cancel the timer
+    TimerId schedule(uint64_t expiry, uint64_t period, functionWrapper task);
+
+    // cancel - removes a pending timer, a periodic timer never runs again
+    // Returns false if the id is unknown, expired or already cancelled
+    bool cancel(TimerId id);
+
+    // advance - moves to tick now, handing every due timer to fire in expiry order
+    // fire: callable receiving a functionWrapper&& for a one-shot timer, or a
+    // shared_ptr<functionWrapper> for a run of a periodic timer
+    template<typename Fire>
+    void advance(uint64_t now, Fire&& fire) {
+        while (m_Current < now) {
+            if (m_Count == 0) {
+                m_Current = now;
+                return;
+            }
+            uint64_t next = nextOccupiedTick();
+            if (next > now) {
+                m_Current = now;
+                return;
+            }
+            m_Current = next;
+            if ((m_Current & (TIMER_WHEEL_SLOTS - 1)) == 0) {
+                cascade();
+            }
+            fireSlot(fire);
+        }
+    }
+
+    // nextWake - tick the wheel must advance to next, UINT64_MAX if no timer is pending.
+    // It may be a cascade point with nothing due, advancing there is cheap.
+    uint64_t nextWake() const {
+        return m_Count == 0 ? UINT64_MAX : nextOccupiedTick();
+    }
+
+    // current - tick the wheel advanced to
+    uint64_t current() const { return m_Current; }
+
+    // size - number of pending timers
+    size_t size() const { return m_Count; }
+
+private:
+    static constexpr uint32_t NONE{UINT32_MAX};
+    static constexpr size_t BITMAP_WORDS{TIMER_WHEEL_SLOTS / 64};
+
+    struct Node {
+        uint64_t expiry{0};
+        uint64_t period{0};
+        uint32_t prev{NONE};
+        uint32_t next{NONE};
+        uint32_t generation{1};
+        uint32_t slot{NONE};                // level * TIMER_WHEEL_SLOTS + slot while pending
+        functionWrapper task;               // one-shot timers
+        shared_ptr<functionWrapper> repeat; // periodic timers
+    };
+
+    vector<Node> m_Nodes;
+    vector<uint32_t> m_FreeNodes;
+    uint32_t m_Heads[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];
+    uint64_t m_Occupied[TIMER_WHEEL_LEVELS][BITMAP_WORDS]{};
+    uint64_t m_Current{0};
+    size_t m_Count{0};
+
+    // link - puts a node into the slot of its expiry, relative to m_Current
+    void link(uint32_t index);
+
+    // unlink - takes a node out of its slot
+    void unlink(uint32_t index);
+
+    // release - frees a node, its ids turn stale
+    void release(uint32_t index);
+
+    // cascade - moves the timers of the higher level slots due at m_Current down
+    void cascade();
+
+    // nextOccupiedTick - next tick after m_Current with a level 0 timer, or the next cascade point
+    uint64_t nextOccupiedTick() const;
+
+    // fireSlot - hands every timer of the level 0 slot of m_Current to fire
+    template<typename Fire>
+    void fireSlot(Fire& fire) {
+        uint32_t slot = static_cast<uint32_t>(m_Current & (TIMER_WHEEL_SLOTS - 1));
+        while (m_Heads[slot] != NONE) {
+            uint32_t index = m_Heads[slot];
+            unlink(index);
+            Node& node = m_Nodes[index];
+            if (node.period == 0) {
+                functionWrapper task = move(node.task);
+                release(index);
+                fire(move(task));
+            } else {
+                node.expiry += node.period;
+                if (node.expiry <= m_Current) {
+                    node.expiry = m_Current + 1; // the wheel fell behind, skip the missed runs
+                }
+                link(index);
+                fire(node.repeat);
+            }
+        }
+    }
+};
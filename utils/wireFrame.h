@@ -0,0 +1,146 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// Two framings share the wire, a connection picks one with its first byte:
+//   ASCII  (v1) a zero padded 4 digit length followed by the payload
+//   BINARY (v2) an 8 byte header: magic, type, flags and a 32 bit length, all
+//               big endian, followed by the payload
+// A binary client opens with a HELLO frame; the server answers with a HELLO and
+// sends it binary frames from then on. ASCII clients never see a binary frame.
+// Messages of any size travel as a stream of CHUNK frames, each one forwarded to
+// the recipients as soon as it arrives.
+constexpr size_t FRAME_HEADER_SIZE{4};
+constexpr size_t MAX_FRAME_PAYLOAD{9999};
+constexpr uint8_t BINARY_FRAME_MAGIC{0xB2};  // never an ASCII digit
+constexpr size_t BINARY_FRAME_HEADER_SIZE{8};
+constexpr size_t MAX_BINARY_FRAME_PAYLOAD{16 * 1024 * 1024};
+
+enum class WireVersion : uint8_t { ASCII = 1, BINARY = 2 };
+
+// FrameType - kind of a binary frame, ASCII frames are always MESSAGE
+enum class FrameType : uint8_t {
+    MESSAGE = 0,  // chat message or room command
+    HELLO = 1,    // version negotiation, empty payload
+    CHUNK = 2     // piece of a streamed message: STREAM_ID_SIZE bytes of stream id, then data
+};
+
+// Flags of a CHUNK frame
+constexpr uint16_t FRAME_FLAG_LAST{0x0001};   // last chunk of the stream
+constexpr uint16_t FRAME_FLAG_ABORT{0x0002};  // the stream ends incomplete, its sender is gone
+
+constexpr size_t STREAM_ID_SIZE{4};
+constexpr size_t STREAM_CHUNK_SIZE{64 * 1024};  // data bytes per chunk sent by the client
+
+// FrameInfo - decoded header of one frame
+struct FrameInfo {
+    size_t length{0};
+    FrameType type{FrameType::MESSAGE};
+    uint16_t flags{0};
+};
+
+// FrameHeader - encoded length prefix of one frame. It is kept apart from the
+// payload so both can be written as separate iovecs, without concatenating them.
+struct FrameHeader {
+    char bytes[FRAME_HEADER_SIZE];
+};
+
+// BinaryFrameHeader - encoded header of one binary frame
+struct BinaryFrameHeader {
+    char bytes[BINARY_FRAME_HEADER_SIZE];
+};
+
+// wireVersionOf - framing announced by the first byte of a connection
+// firstByte: first byte received
+inline WireVersion wireVersionOf(char firstByte) {
+    return static_cast<WireVersion>(1 + (static_cast<uint8_t>(firstByte) == BINARY_FRAME_MAGIC));
+}
+
+// frameHeaderSize - header size of a framing
+inline size_t frameHeaderSize(WireVersion version) {
+    return version == WireVersion::BINARY ? BINARY_FRAME_HEADER_SIZE : FRAME_HEADER_SIZE;
+}
+
+// maxFramePayload - largest payload a framing can carry
+inline size_t maxFramePayload(WireVersion version) {
+    return version == WireVersion::BINARY ? MAX_BINARY_FRAME_PAYLOAD : MAX_FRAME_PAYLOAD;
+}
+
+// encodeFrameHeader - encodes the length prefix of a payload
+// length: payload size in bytes, at most MAX_FRAME_PAYLOAD
+// Returns the encoded header
+inline FrameHeader encodeFrameHeader(size_t length) {
+    FrameHeader header;
+    header.bytes[0] = static_cast<char>('0' + length / 1000 % 10);
+    header.bytes[1] = static_cast<char>('0' + length / 100 % 10);
+    header.bytes[2] = static_cast<char>('0' + length / 10 % 10);
+    header.bytes[3] = static_cast<char>('0' + length % 10);
+    return header;
+}
+
+// decodeFrameHeader - decodes an ASCII length prefix
+// bytes: FRAME_HEADER_SIZE received bytes
+// length: output parameter that receives the payload size
+// Returns false if a byte is not a digit
+inline bool decodeFrameHeader(const char* bytes, size_t& length) {
+    // Non digits wrap around to values above 9
+    uint32_t d0 = static_cast<uint8_t>(bytes[0]) - static_cast<uint32_t>('0');
+    uint32_t d1 = static_cast<uint8_t>(bytes[1]) - static_cast<uint32_t>('0');
+    uint32_t d2 = static_cast<uint8_t>(bytes[2]) - static_cast<uint32_t>('0');
+    uint32_t d3 = static_cast<uint8_t>(bytes[3]) - static_cast<uint32_t>('0');
+    length = d0 * 1000 + d1 * 100 + d2 * 10 + d3;
+    return ((d0 > 9) | (d1 > 9) | (d2 > 9) | (d3 > 9)) == 0;
+}
+
+// encodeBinaryFrameHeader - encodes the header of a binary frame
+// length: payload size in bytes, at most MAX_BINARY_FRAME_PAYLOAD
+// type: frame type
+// flags: frame flags
+// Returns the encoded header
+inline BinaryFrameHeader encodeBinaryFrameHeader(size_t length, FrameType type = FrameType::MESSAGE, uint16_t flags = 0) {
+    BinaryFrameHeader header;
+    uint32_t length32 = static_cast<uint32_t>(length);
+    header.bytes[0] = static_cast<char>(BINARY_FRAME_MAGIC);
+    header.bytes[1] = static_cast<char>(type);
+    header.bytes[2] = static_cast<char>(flags >> 8);
+    header.bytes[3] = static_cast<char>(flags);
+    header.bytes[4] = static_cast<char>(length32 >> 24);
+    header.bytes[5] = static_cast<char>(length32 >> 16);
+    header.bytes[6] = static_cast<char>(length32 >> 8);
+    header.bytes[7] = static_cast<char>(length32);
+    return header;
+}
+
+// decodeBinaryFrameHeader - decodes the header of a binary frame
+// bytes: BINARY_FRAME_HEADER_SIZE received bytes
+// info: output parameter that receives the decoded header
+// Returns false if the magic byte is wrong or the length exceeds MAX_BINARY_FRAME_PAYLOAD
+inline bool decodeBinaryFrameHeader(const char* bytes, FrameInfo& info) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(bytes);
+    uint32_t length = (static_cast<uint32_t>(data[4]) << 24) | (static_cast<uint32_t>(data[5]) << 16) |
+                      (static_cast<uint32_t>(data[6]) << 8) | data[7];
+    info.length = length;
+    info.type = static_cast<FrameType>(data[1]);
+    info.flags = static_cast<uint16_t>((data[2] << 8) | data[3]);
+    return ((data[0] == BINARY_FRAME_MAGIC) & (length <= MAX_BINARY_FRAME_PAYLOAD)) != 0;
+}
+
+// encodeStreamId - writes the big endian stream id that starts a CHUNK payload
+// streamId: the stream id
+// bytes: destination, STREAM_ID_SIZE bytes
+inline void encodeStreamId(uint32_t streamId, char* bytes) {
+    bytes[0] = static_cast<char>(streamId >> 24);
+    bytes[1] = static_cast<char>(streamId >> 16);
+    bytes[2] = static_cast<char>(streamId >> 8);
+    bytes[3] = static_cast<char>(streamId);
+}
+
+// decodeStreamId - reads the stream id that starts a CHUNK payload
+// bytes: STREAM_ID_SIZE received bytes
+inline uint32_t decodeStreamId(const char* bytes) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(bytes);
+    return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+           (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}